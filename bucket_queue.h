@@ -0,0 +1,119 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+
+#ifndef _BUCKET_QUEUE_H
+#define _BUCKET_QUEUE_H
+
+#include "util.h"
+
+/** Scales a distance to an integer key of a BucketQueue. Distances closer than 1/16 can be popped in the
+    wrong order, which only costs some extra work in searches that queue and expand a square again after
+    its distance improved.*/
+inline long long getBucketKey(double dist) {
+  return (long long) floor(dist * 16);
+}
+
+/**
+  * Monotone priority queue with integer keys (radix heap). Elements are kept in buckets by the
+  * highest bit in which their key differs from the last popped key, so push is O(1) and pop is
+  * amortized O(log C), where C is the range of the keys. A pushed key lower than the last popped one
+  * is treated as equal to it, which keeps searches with a slightly inconsistent heuristic working.
+  * Elements with equal keys are popped in any order. The buckets keep their memory after clear().
+  */
+template <class T>
+class BucketQueue {
+  public:
+  void clear() {
+    for (auto& bucket : buckets)
+      bucket.clear();
+    size = 0;
+    last = 0;
+  }
+
+  bool isEmpty() const {
+    return size == 0;
+  }
+
+  int getSize() const {
+    return size;
+  }
+
+  void push(T elem, long long key) {
+    unsigned long long k = max(toUnsigned(key), last);
+    buckets[getBucket(k)].push_back({k, std::move(elem)});
+    ++size;
+  }
+
+  /** Key of the top element, adjusted to the last popped one if it was lower.*/
+  long long getTopKey() {
+    pull();
+    return (long long) (buckets[0].back().key ^ signBit);
+  }
+
+  const T& getTop() {
+    pull();
+    return buckets[0].back().elem;
+  }
+
+  T pop() {
+    pull();
+    T ret = std::move(buckets[0].back().elem);
+    buckets[0].pop_back();
+    --size;
+    return ret;
+  }
+
+  private:
+  struct Entry {
+    unsigned long long key;
+    T elem;
+  };
+
+  static const unsigned long long signBit = 1ULL << 63;
+
+  /** Maps signed keys to unsigned ones with the same order.*/
+  static unsigned long long toUnsigned(long long key) {
+    return ((unsigned long long) key) ^ signBit;
+  }
+
+  int getBucket(unsigned long long key) const {
+    return key == last ? 0 : 64 - __builtin_clzll(key ^ last);
+  }
+
+  /** Makes sure that the first bucket contains the minimum elements.*/
+  void pull() {
+    CHECK(size > 0) << "Popping from empty queue";
+    if (!buckets[0].empty())
+      return;
+    int index = 1;
+    while (buckets[index].empty())
+      ++index;
+    last = buckets[index][0].key;
+    for (const Entry& entry : buckets[index])
+      last = min(last, entry.key);
+    // All elements of the bucket go to lower buckets.
+    redistribute.swap(buckets[index]);
+    for (Entry& entry : redistribute)
+      buckets[getBucket(entry.key)].push_back(std::move(entry));
+    redistribute.clear();
+  }
+
+  vector<Entry> buckets[65];
+  vector<Entry> redistribute;
+  unsigned long long last = 0;
+  int size = 0;
+};
+
+#endif
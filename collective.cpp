@@ -15,6 +15,8 @@
 #include "trigger.h"
 #include "model.h"
 #include "spell.h"
+#include "profiler.h"
+#include "path_batch.h"
 
 template <class Archive>
 void Collective::serialize(Archive& ar, const unsigned int version) {
@@ -58,6 +60,8 @@ void Collective::serialize(Archive& ar, const unsigned int version) {
     & SVAR(torches)
     & SVAR(name)
     & SVAR(config);
+  if (Archive::is_loading::value)
+    setEventScope();
 }
 
 SERIALIZABLE(Collective);
@@ -149,6 +153,15 @@ map<MinionTask, Collective::MinionTaskInfo> Collective::getTaskInfo() const {
 Collective::Collective(Level* l, CollectiveConfig cfg, Tribe* t, EnumMap<ResourceId, int> _credit, const string& n) 
   : credit(_credit), taskMap(l->getBounds()), knownTiles(l->getBounds()), control(CollectiveControl::idle(this)),
   tribe(NOTNULL(t)), level(NOTNULL(l)), nextPayoutTime(-1), name(n), config(cfg) {
+  setEventScope();
+}
+
+void Collective::setEventScope() {
+  // These handlers only care about events on the collective's level.
+  GlobalEvents.SquareDestroyedEvent.setScope(this, level);
+  GlobalEvents.AlarmEvent.setScope(this, level);
+  GlobalEvents.TrapTriggerEvent.setScope(this, level);
+  GlobalEvents.TrapDisarmEvent.setScope(this, level);
 }
 
 const string& Collective::getName() const {
@@ -220,6 +233,7 @@ void Collective::addCreature(Creature* c, EnumSet<MinionTrait> traits) {
     traits.insert(MinionTrait::LEADER);
   CHECK(c->getTribe() == tribe);
   creatures.push_back(c);
+  level->getModel()->addCollectiveMember(this, c);
   for (MinionTrait t : traits)
     byTrait[t].push_back(c);
   if (auto spawnType = c->getSpawnType())
@@ -525,20 +539,50 @@ PTask Collective::getHealingTask(Creature* c) {
   return nullptr;
 }
 
-MoveInfo Collective::getTeamMemberMove(Creature* c) {
+/** Leader of the first active team of the creature on its level, unless it's the leader itself.*/
+const Creature* Collective::getFollowedLeader(const Creature* c) const {
   for (auto team : teams.getContaining(c))
     if (teams.isActive(team)) {
-        const Creature* leader = teams.getLeader(team);
-        if (c != leader && leader->getLevel() == c->getLevel()) {
-            if (leader->getPosition().dist8(c->getPosition()) > 1)
-              return c->moveTowards(teams.getLeader(team)->getPosition());
-            else
-              return c->wait();
-        }
+      const Creature* leader = teams.getLeader(team);
+      if (c != leader && leader->getLevel() == c->getLevel())
+        return leader;
     }
+  return nullptr;
+}
+
+MoveInfo Collective::getTeamMemberMove(Creature* c) {
+  if (const Creature* leader = getFollowedLeader(c)) {
+    if (leader->getPosition().dist8(c->getPosition()) > 1)
+      return c->moveTowards(leader->getPosition());
+    else
+      return c->wait();
+  }
   return NoMove;
 }
 
+/** Finds the paths of all team members that lost track of their leader together, before any of them
+    moves. Their moveTowards() then only follows and repairs them. A flow field keyed by the leader's
+    position wouldn't pay off, because the leader moves almost every turn and each step would need a new
+    field that searches further than the followers' short paths.*/
+void Collective::findTeamPaths() {
+  PROFILE_ZONE("Collective::findTeamPaths");
+  PathBatch batch;
+  vector<Creature*> followers;
+  for (Creature* c : creatures)
+    if (const Creature* leader = getFollowedLeader(c)) {
+      Vec2 target = leader->getPosition();
+      if (target.dist8(c->getPosition()) > 1 && c->needsNewPath(target)) {
+        batch.add(c->getLevel(), c, target, c->getPosition());
+        followers.push_back(c);
+      }
+    }
+  if (followers.empty())
+    return;
+  batch.run();
+  for (int i : All(followers))
+    followers[i]->setPath(batch.getPath(i));
+}
+
 void Collective::setTask(const Creature *c, PTask task) {
   if (Task* task = taskMap.getTask(c)) {
     if (!task->canTransfer()) {
@@ -1005,6 +1049,7 @@ void Collective::considerWeaponWarning() {
 }
 
 void Collective::tick(double time) {
+  PROFILE_ZONE("Collective::tick");
   control->tick(time);
   considerHealingLeader();
   considerBirths();
@@ -1071,6 +1116,7 @@ void Collective::tick(double time) {
     }
   if (config.getManageEquipment() && Random.roll(10))
     minionEquipment.updateOwners(getAllItems(true));
+  findTeamPaths();
 }
 
 const vector<Creature*>& Collective::getCreatures(MinionTrait trait) const {
@@ -1150,10 +1196,14 @@ void Collective::decreaseMoraleForKill(const Creature* killer, const Creature* v
     c->addMorale(victim == getLeader() ? -2 : -0.015);
 }
 
+bool Collective::hasCreature(const Creature* c) const {
+  return contains(level->getModel()->getCollectives(c), this);
+}
+
 void Collective::onKillEvent(const Creature* victim1, const Creature* killer) {
-  if (contains(creatures, victim1)) {
+  if (hasCreature(victim1)) {
     Creature* victim = const_cast<Creature*>(victim1);
-    if (hasTrait(victim, MinionTrait::PRISONER) && killer && contains(getCreatures(), killer)
+    if (hasTrait(victim, MinionTrait::PRISONER) && killer && hasCreature(killer)
       && prisonerInfo.at(victim).state() == PrisonerState::EXECUTE)
       returnResource({ResourceId::PRISONER_HEAD, 1});
     if (hasTrait(victim, MinionTrait::LEADER))
@@ -1162,6 +1212,7 @@ void Collective::onKillEvent(const Creature* victim1, const Creature* killer) {
     freeFromGuardPost(victim);
     decreaseMoraleForKill(killer, victim);
     removeElement(creatures, victim);
+    level->getModel()->removeCollectiveMember(this, victim);
     minionAttraction.erase(victim);
     if (Task* task = taskMap.getTask(victim)) {
       if (!task->canTransfer()) {
@@ -1297,7 +1348,8 @@ const set<Vec2>& Collective::getAllSquares() const {
 }
 
 void Collective::claimSquare(Vec2 pos) {
-  allSquares.insert(pos);
+  if (allSquares.insert(pos).second)
+    ++territoryVersion;
 }
 
 void Collective::changeSquareType(Vec2 pos, SquareType from, SquareType to) {
@@ -1309,6 +1361,14 @@ bool Collective::containsSquare(Vec2 pos) const {
   return allSquares.count(pos);
 }
 
+CreatureAction Collective::moveIntoTerritory(Creature* c) {
+  if (territoryBuiltVersion != territoryVersion) {
+    territory.assign(allSquares.begin(), allSquares.end());
+    territoryBuiltVersion = territoryVersion;
+  }
+  return c->moveAlongFlowField({this, territoryVersion}, territory);
+}
+
 bool Collective::isKnownSquare(Vec2 pos) const {
   return knownTiles.isKnown(pos);
 }
@@ -1374,9 +1434,10 @@ void Collective::onAlarmEvent(const Level* l, Vec2 pos) {
   }
 }
 
+/** Fighters answering the alarm share a flow field, which stays valid because the alarm doesn't move.*/
 MoveInfo Collective::getAlarmMove(Creature* c) {
   if (alarmInfo.finishTime() > c->getTime())
-    if (auto action = c->moveTowards(alarmInfo.position()))
+    if (auto action = c->moveAlongFlowField({alarmInfo.position()}))
       return {1.0, action};
   return NoMove;
 }
@@ -1762,7 +1823,7 @@ void Collective::onConstructionCancelled(Vec2 pos) {
 
 void Collective::onConstructed(Vec2 pos, SquareType type) {
   if (!contains({SquareId::TREE_TRUNK}, type.getId()))
-    allSquares.insert(pos);
+    claimSquare(pos);
   CHECK(!getSquares(type).count(pos));
   for (auto& elem : mySquares)
       elem.second.erase(pos);
@@ -1905,7 +1966,7 @@ void Collective::fetchItems(Vec2 pos, const ItemFetchInfo& elem) {
 }
 
 void Collective::onSurrenderEvent(Creature* who, const Creature* to) {
-  if (contains(getCreatures(), to) && !contains(getCreatures(), who) && !prisonerInfo.count(who) && who->isHumanoid())
+  if (hasCreature(to) && !hasCreature(who) && !prisonerInfo.count(who) && who->isHumanoid())
     prisonerInfo[who] = {PrisonerState::SURRENDER, 0};
 }
 
@@ -2199,7 +2260,7 @@ void Collective::onCopulated(Creature* who, Creature* with) {
         + " with a monkey on " + who->getGender().his() + " knee");
   else
     control->addMessage(who->getName().a() + " makes love to " + with->getName().a());
-  if (contains(getCreatures(), with))
+  if (hasCreature(with))
     with->addMorale(1);
   if (!contains(pregnancies, who)) 
     pregnancies.push_back(who);
@@ -92,6 +92,7 @@ class Collective : public Task::Callback {
 
   vector<Creature*>& getCreatures();
   const vector<Creature*>& getCreatures() const;
+  bool hasCreature(const Creature*) const;
   bool isConquered() const;
 
   const vector<Creature*>& getCreatures(SpawnType) const;
@@ -120,6 +121,9 @@ class Collective : public Task::Callback {
   void claimSquare(Vec2);
   void changeSquareType(Vec2 pos, SquareType from, SquareType to);
   bool containsSquare(Vec2 pos) const;
+  /** Moves the creature towards the collective's squares along a flow field shared with everyone else
+      heading there.*/
+  CreatureAction moveIntoTerritory(Creature*);
   bool isKnownSquare(Vec2 pos) const;
   bool underAttack() const;
 
@@ -328,6 +332,7 @@ class Collective : public Task::Callback {
 
   void addMoraleForKill(const Creature* killer, const Creature* victim);
   void decreaseMoraleForKill(const Creature* killer, const Creature* victim);
+  void setEventScope();
 
   double getAttractionValue(MinionAttraction);
   double getImmigrantChance(const ImmigrantInfo&);
@@ -375,6 +380,8 @@ class Collective : public Task::Callback {
   MoveInfo getDropItems(Creature*);
   MoveInfo getWorkerMove(Creature*);
   MoveInfo getTeamMemberMove(Creature*);
+  const Creature* getFollowedLeader(const Creature*) const;
+  void findTeamPaths();
   bool usesEquipment(const Creature* c) const;
   void autoEquipment(Creature* creature, bool replace);
   Item* getWorstItem(vector<Item*> items) const;
@@ -400,6 +407,10 @@ class Collective : public Task::Callback {
   unordered_map<SquareType, set<Vec2>> SERIAL(mySquares);
   map<Vec2, int> SERIAL(squareEfficiency);
   set<Vec2> SERIAL(allSquares);
+  /** Changes with allSquares, so that the flow field towards them is found without comparing the squares.*/
+  int territoryVersion = 0;
+  vector<Vec2> territory;
+  int territoryBuiltVersion = -1;
   struct AlarmInfo : NamedTupleBase<double, Vec2> {
     NAMED_TUPLE_STUFF(AlarmInfo);
     AlarmInfo() { finishTime() = -1000; }
@@ -26,6 +26,7 @@
 #include "effect.h"
 #include "item_factory.h"
 #include "square.h"
+#include "profiler.h"
 
 template <class Archive> 
 void Creature::MoraleOverride::serialize(Archive& ar, const unsigned int version) {
@@ -312,7 +313,10 @@ void Creature::makeMove() {
   updateViewObject();
   if (swapPositionCooldown)
     --swapPositionCooldown;
-  MEASURE(controller->makeMove(), "creature move time");
+  {
+    PROFILE_ZONE("Controller::makeMove");
+    controller->makeMove();
+  }
   Debug() << getName().bare() << " morale " << getMorale();
   if (!hidden)
     modViewObject().removeModifier(ViewObject::Modifier::HIDDEN);
@@ -790,9 +794,33 @@ void Creature::addEffect(LastingEffect effect, double time, bool msg) {
     if (!isAffected(effect))
       onAffected(effect, msg);
     lastingEffects[effect] = getTime() + time;
+    addEffectTimer(effect);
   }
 }
 
+void Creature::addEffectTimer(LastingEffect effect) {
+  if (level)
+    level->getModel()->addEffectTimer(this, effect, lastingEffects[effect]);
+}
+
+void Creature::addEffectTimers(Model* model) {
+  for (LastingEffect effect : ENUM_ALL(LastingEffect))
+    if (lastingEffects[effect] > 0)
+      model->addEffectTimer(this, effect, lastingEffects[effect]);
+}
+
+void Creature::onEffectTimer(LastingEffect effect, double endTime, double realTime) {
+  // The effect was extended, shortened or removed after the timer was set.
+  if (lastingEffects[effect] != endTime)
+    return;
+  if (endTime < realTime) {
+    lastingEffects[effect] = 0;
+    if (!isAffected(effect))
+      onTimedOut(effect, true);
+  } else
+    addEffectTimer(effect);
+}
+
 void Creature::removeEffect(LastingEffect effect, bool msg) {
   if (!isAffected(effect))
     return;
@@ -1047,6 +1075,8 @@ void Creature::setPosition(Vec2 pos) {
 }
 
 void Creature::setLevel(Level* l) {
+  if (l != level)
+    shortestPath = none;
   level = l;
 }
 
@@ -1067,12 +1097,6 @@ void Creature::tick(double realTime) {
     if (item->isDiscarded())
       equipment.removeItem(item);
   }
-  for (LastingEffect effect : ENUM_ALL(LastingEffect))
-    if (lastingEffects[effect] > 0 && lastingEffects[effect] < realTime) {
-      lastingEffects[effect] = 0;
-      if (!isAffected(effect))
-        onTimedOut(effect, true);
-    }
   if (isAffected(LastingEffect::POISON)) {
     bleed(1.0 / 60);
     playerMessage("You feel poison flowing in your veins.");
@@ -1357,6 +1381,7 @@ bool Creature::takeDamage(const Attack& attack) {
   }
   if (isAffected(LastingEffect::MAGIC_SHIELD)) {
     lastingEffects[LastingEffect::MAGIC_SHIELD] -= 5;
+    addEffectTimer(LastingEffect::MAGIC_SHIELD);
     globalMessage("The magic shield absorbs the attack", "");
   }
   if (attack.getStrength() > defense) {
@@ -2210,21 +2235,11 @@ CreatureAction Creature::moveTowards(Vec2 pos, bool stepOnTile) {
 CreatureAction Creature::moveTowards(Vec2 pos, bool away, bool stepOnTile) {
   if (stepOnTile && !level->getSafeSquare(pos)->canEnterEmpty(this))
     return CreatureAction();
-  if (!away) {
-    bool sectorOk = false;
-    MovementType movement = getMovementType();
-    for (Vec2 v : pos.neighbors8())
-      if (v.inRectangle(level->getBounds()) && level->areConnected(position, v, movement)) {
-        sectorOk = true;
-        break;
-      }
-    if (!sectorOk)
-      return CreatureAction();
-  }
+  if (!away && !canApproach(pos))
+    return CreatureAction();
   Debug() << "" << getPosition() << (away ? "Moving away from" : " Moving toward ") << pos;
   bool newPath = false;
-  bool targetChanged = shortestPath && shortestPath->getTarget().dist8(pos) > getPosition().dist8(pos) / 10;
-  if (!shortestPath || targetChanged || shortestPath->isReversed() != away) {
+  if (!updatePath(pos, away)) {
     newPath = true;
     if (!away)
       shortestPath = ShortestPath(getLevel(), this, pos, getPosition());
@@ -2232,18 +2247,22 @@ CreatureAction Creature::moveTowards(Vec2 pos, bool away, bool stepOnTile) {
       shortestPath = ShortestPath(getLevel(), this, pos, getPosition(), -1.5);
   }
   CHECK(shortestPath);
+  optional<Vec2> blocked;
   if (shortestPath->isReachable(getPosition())) {
     Vec2 pos2 = shortestPath->getNextMove(getPosition());
     if (auto action = move(pos2 - getPosition()))
       return action;
+    blocked = pos2;
   }
   if (newPath)
     return CreatureAction();
   Debug() << "Reconstructing shortest path.";
-  if (!away)
-    shortestPath = ShortestPath(getLevel(), this, pos, getPosition());
-  else
-    shortestPath = ShortestPath(getLevel(), this, pos, getPosition(), -1.5);
+  if (!blocked || !shortestPath->updateSquare(*blocked, getPosition())) {
+    if (!away)
+      shortestPath = ShortestPath(getLevel(), this, pos, getPosition());
+    else
+      shortestPath = ShortestPath(getLevel(), this, pos, getPosition(), -1.5);
+  }
   if (shortestPath->isReachable(getPosition())) {
     Vec2 pos2 = shortestPath->getNextMove(getPosition());
     if (auto action = move(pos2 - getPosition()))
@@ -2260,10 +2279,75 @@ CreatureAction Creature::moveTowards(Vec2 pos, bool away, bool stepOnTile) {
   }
 }
 
+/** Returns if the current path can still be used for moving towards or away from the position.*/
+bool Creature::updatePath(Vec2 pos, bool away) {
+  if (shortestPath && !away && shortestPath->getTarget() != pos)
+    shortestPath->updateTarget(pos, getPosition());
+  bool targetChanged = shortestPath && shortestPath->getTarget().dist8(pos) > getPosition().dist8(pos) / 10;
+  return shortestPath && !targetChanged && shortestPath->isReversed() == away;
+}
+
+bool Creature::needsNewPath(Vec2 target) {
+  return canApproach(target) && !updatePath(target, false);
+}
+
+void Creature::setPath(const ShortestPath& path) {
+  shortestPath = path;
+}
+
+bool Creature::canApproach(Vec2 pos) const {
+  MovementType movement = getMovementType();
+  for (Vec2 v : pos.neighbors8())
+    if (v.inRectangle(level->getBounds()) && level->areConnected(position, v, movement))
+      return true;
+  return false;
+}
+
+CreatureAction Creature::moveAlongFlowField(vector<Vec2> targets) {
+  if (targets.empty())
+    return CreatureAction();
+  // Unreachable targets are left in, so that everyone asks for the same field.
+  return followFlowField(level->getFlowField(getMovementType(), targets), targets);
+}
+
+CreatureAction Creature::moveAlongFlowField(FlowFieldKey key, const vector<Vec2>& targets) {
+  if (targets.empty())
+    return CreatureAction();
+  return followFlowField(level->getFlowField(getMovementType(), key, targets), targets);
+}
+
+CreatureAction Creature::followFlowField(FlowField& field, const vector<Vec2>& targets) {
+  for (Vec2 next : field.getNextMoves(position))
+    if (auto action = move(next - position))
+      return action;
+  double dist = field.getDistance(position);
+  if (dist == 0 || dist >= ShortestPath::infinity)
+    return CreatureAction();
+  // The way is blocked by other creatures or by something that needs to be destroyed.
+  vector<Vec2> approachable = filter(targets, [this](Vec2 v) { return canApproach(v); });
+  if (approachable.empty())
+    return CreatureAction();
+  Vec2 closest = *std::min_element(approachable.begin(), approachable.end(),
+      [this](Vec2 v1, Vec2 v2) { return position.dist8(v1) < position.dist8(v2); });
+  return moveTowards(closest);
+}
+
 CreatureAction Creature::moveAway(Vec2 pos, bool pathfinding) {
-  if ((pos - getPosition()).length8() <= 5 && pathfinding)
+  return moveAway(pos, {}, pathfinding);
+}
+
+CreatureAction Creature::moveAway(Vec2 pos, const vector<Vec2>& group, bool pathfinding) {
+  if ((pos - getPosition()).length8() <= 5 && pathfinding) {
+    const SafetyMap* safetyMap = group.empty() ? nullptr
+        : getLevel()->getSafetyMap(getMovementType(), group, getTime());
+    if (safetyMap) {
+      for (Vec2 v : safetyMap->getSaferMoves(getPosition()))
+        if (auto action = move(v - getPosition()))
+          return action;
+    } else
     if (auto action = moveTowards(pos, true, false))
       return action;
+  }
   pair<Vec2, Vec2> dirs = (getPosition() - pos).approxL1();
   vector<CreatureAction> moves;
   if (auto action = move(dirs.first))
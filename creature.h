@@ -21,6 +21,7 @@
 #include "enums.h"
 #include "attack.h"
 #include "shortest_path.h"
+#include "flow_field.h"
 #include "tribe.h"
 #include "skill.h"
 #include "controller.h"
@@ -223,7 +224,21 @@ class Creature : private CreatureAttributes, public Renderable, public UniqueEnt
   vector<vector<Item*>> stackItems(vector<Item*>) const;
 
   CreatureAction moveTowards(Vec2 pos, bool stepOnTile = false);
+  /** Returns if moveTowards() would search for a new path to the target. The current path is repaired
+      first if possible, like moveTowards() does.*/
+  bool needsNewPath(Vec2 target);
+  /** Path to be followed by moveTowards(), found in advance, eg. in a PathBatch.*/
+  void setPath(const ShortestPath&);
+  /** Moves towards the closest of the targets along a flow field shared with other creatures. Cheaper
+      than moveTowards() when many creatures head for the same fixed squares, eg. an alarm, a storage or
+      a dungeon. Moving targets need a new field every turn, so they should use moveTowards().*/
+  CreatureAction moveAlongFlowField(vector<Vec2> targets);
+  /** Same as above, with the field looked up by the key instead of the targets.*/
+  CreatureAction moveAlongFlowField(FlowFieldKey, const vector<Vec2>& targets);
   CreatureAction moveAway(Vec2 pos, bool pathfinding = true);
+  /** Moves away from pos, which belongs to a group of threats, eg. an attacker and its allies. With
+      pathfinding, it follows a safety map shared by all creatures fleeing from the same group.*/
+  CreatureAction moveAway(Vec2 pos, const vector<Vec2>& group, bool pathfinding = true);
   CreatureAction continueMoving();
   CreatureAction stayIn(const Location*);
   bool isSameSector(Vec2) const;
@@ -262,6 +277,10 @@ class Creature : private CreatureAttributes, public Renderable, public UniqueEnt
 
   void addEffect(LastingEffect, double time, bool msg = true);
   void removeEffect(LastingEffect, bool msg = true);
+  /** Called by Model when a timer for a lasting effect set to end at endTime comes due.*/
+  void onEffectTimer(LastingEffect, double endTime, double realTime);
+  /** Sets timers for all lasting effects that haven't expired yet.*/
+  void addEffectTimers(Model*);
   void addPermanentEffect(LastingEffect, bool msg = true);
   void removePermanentEffect(LastingEffect, bool msg = true);
   bool isAffected(LastingEffect) const;
@@ -285,6 +304,7 @@ class Creature : private CreatureAttributes, public Renderable, public UniqueEnt
   bool wasInCombat(double numLastTurns) const;
 
   private:
+  friend class TimeQueue;
   REGISTER_HANDLER(KillEvent, const Creature* victim, const Creature* killer);
 
   double getExpLevelDouble() const;
@@ -295,7 +315,11 @@ class Creature : private CreatureAttributes, public Renderable, public UniqueEnt
   void consumeBodyParts(const EnumMap<BodyPart, int>&);
   void onRemoved(LastingEffect effect, bool msg);
   void onTimedOut(LastingEffect effect, bool msg);
+  void addEffectTimer(LastingEffect);
   CreatureAction moveTowards(Vec2 pos, bool away, bool stepOnTile);
+  bool updatePath(Vec2 pos, bool away);
+  bool canApproach(Vec2 pos) const;
+  CreatureAction followFlowField(FlowField&, const vector<Vec2>& targets);
   double getInventoryWeight() const;
   Item* getAmmo() const;
   void updateViewObject();
@@ -348,6 +372,7 @@ class Creature : private CreatureAttributes, public Renderable, public UniqueEnt
   vector<string> SERIAL(personalEvents);
   bool forceMovement = false;
   optional<double> SERIAL(lastCombatTime);
+  int timeQueueSlot = -1;
 };
 
 BOOST_CLASS_VERSION(Creature, 1)
@@ -385,7 +385,8 @@ static void acid(Creature* c) {
 }
 
 static void alarm(Creature* c) {
-  GlobalEvents.addAlarmEvent(c->getLevel(), c->getPosition());
+  // Everyone answers the alarm at the end of the turn, together with other alarms set off meanwhile.
+  GlobalEvents.deferAlarmEvent(c->getLevel(), c->getPosition());
 }
 
 static void teleEnemies(Creature* c) { // handled by Collective
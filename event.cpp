@@ -20,3 +20,12 @@
 
 EventListener GlobalEvents;
 
+EventChannelBase::EventChannelBase(vector<EventChannelBase*>& all) {
+  all.push_back(this);
+}
+
+void EventListener::flushDeferred() {
+  for (EventChannelBase* channel : channels)
+    channel->flushDeferred();
+}
+
@@ -23,25 +23,241 @@ class Creature;
 class Item;
 class Technology;
 class Deity;
+class Collective;
 enum class WorshipType;
 enum class AssaultType;
 
+/** Compile-time list of indices used to unpack stored event arguments.*/
+template <size_t... I>
+struct IndexSequence {};
+
+template <size_t N, size_t... I>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...> {};
+
+template <size_t... I>
+struct MakeIndexSequence<0, I...> {
+  typedef IndexSequence<I...> type;
+};
+
+class EventChannelBase {
+  public:
+  EventChannelBase(vector<EventChannelBase*>& all);
+  virtual void unsubscribe(const void* obj) = 0;
+  virtual void flushDeferred() = 0;
+
+  protected:
+  ~EventChannelBase() {}
+};
+
+/** Events whose first argument is a level are only delivered to subscribers in that level's scope,
+    and to unscoped subscribers.*/
+template <typename... Args>
+struct EventScope {
+  static const void* get(const Args&...) {
+    return nullptr;
+  }
+};
+
+template <typename... Args>
+struct EventScope<const Level*, Args...> {
+  static const void* get(const Level* level, const Args&...) {
+    return level;
+  }
+};
+
+template <typename Signature>
+class EventChannel;
+
+/**
+  * Subscribers of a single event type, kept in contiguous arrays. It's allowed to subscribe and
+  * unsubscribe while an event is being delivered. New subscribers don't receive the current event.
+  */
+template <typename... Args>
+class EventChannel<void(Args...)> : public EventChannelBase {
+  public:
+  typedef function<void(Args...)> Fun;
+
+  using EventChannelBase::EventChannelBase;
+
+  void subscribe(const void* obj, Fun fun, const void* scope = nullptr) {
+    unsubscribe(obj);
+    if (dispatching > 0)
+      pending.push_back({obj, std::move(fun), scope});
+    else
+      add(obj, std::move(fun), scope);
+  }
+
+  virtual void unsubscribe(const void* obj) override {
+    for (int i : All(pending))
+      if (pending[i].obj == obj) {
+        pending.erase(pending.begin() + i);
+        return;
+      }
+    auto it = index.find(obj);
+    if (it == index.end())
+      return;
+    Subscribers& subscribers = getSubscribers(it->second.scope);
+    int pos = it->second.pos;
+    index.erase(it);
+    if (dispatching > 0) {
+      // The function might be running right now, so it's destroyed after the delivery.
+      subscribers.objs[pos] = nullptr;
+      needsCompacting = true;
+    } else
+      removeAt(subscribers, pos);
+  }
+
+  /** Moves the subscriber to a different scope. nullptr means that it receives all events.*/
+  void setScope(const void* obj, const void* scope) {
+    auto it = index.find(obj);
+    if (it == index.end() || it->second.scope == scope)
+      return;
+    Fun fun = getSubscribers(it->second.scope).funs[it->second.pos];
+    subscribe(obj, std::move(fun), scope);
+  }
+
+  void publish(Args... args) {
+    ++dispatching;
+    deliver(global, args...);
+    if (const void* scope = EventScope<Args...>::get(args...)) {
+      auto it = scoped.find(scope);
+      if (it != scoped.end())
+        deliver(it->second, args...);
+    }
+    if (--dispatching == 0)
+      cleanUp();
+  }
+
+  /** Stores the event until flushDeferred() is called. Reference arguments are copied.*/
+  void defer(Args... args) {
+    deferred.emplace_back(args...);
+  }
+
+  virtual void flushDeferred() override {
+    vector<tuple<typename std::decay<Args>::type...>> events;
+    events.swap(deferred);
+    for (auto& elem : events)
+      publishTuple(elem, typename MakeIndexSequence<sizeof...(Args)>::type());
+  }
+
+  int getNumSubscribers() const {
+    return index.size() + pending.size();
+  }
+
+  private:
+  struct Subscribers {
+    vector<const void*> objs;
+    vector<Fun> funs;
+  };
+
+  struct Index {
+    const void* scope;
+    int pos;
+  };
+
+  struct Pending {
+    const void* obj;
+    Fun fun;
+    const void* scope;
+  };
+
+  Subscribers& getSubscribers(const void* scope) {
+    return scope ? scoped.at(scope) : global;
+  }
+
+  void add(const void* obj, Fun fun, const void* scope) {
+    Subscribers& subscribers = scope ? scoped[scope] : global;
+    index[obj] = {scope, int(subscribers.objs.size())};
+    subscribers.objs.push_back(obj);
+    subscribers.funs.push_back(std::move(fun));
+  }
+
+  void removeAt(Subscribers& subscribers, int pos) {
+    int last = subscribers.objs.size() - 1;
+    if (pos < last) {
+      subscribers.objs[pos] = subscribers.objs[last];
+      subscribers.funs[pos] = std::move(subscribers.funs[last]);
+      index.at(subscribers.objs[pos]).pos = pos;
+    }
+    subscribers.objs.pop_back();
+    subscribers.funs.pop_back();
+  }
+
+  void compact(Subscribers& subscribers) {
+    int size = 0;
+    for (int i : All(subscribers.objs))
+      if (subscribers.objs[i]) {
+        if (i != size) {
+          subscribers.objs[size] = subscribers.objs[i];
+          subscribers.funs[size] = std::move(subscribers.funs[i]);
+          index.at(subscribers.objs[size]).pos = size;
+        }
+        ++size;
+      }
+    subscribers.objs.resize(size);
+    subscribers.funs.resize(size);
+  }
+
+  void cleanUp() {
+    if (needsCompacting) {
+      compact(global);
+      for (auto it = scoped.begin(); it != scoped.end();) {
+        compact(it->second);
+        if (it->second.objs.empty())
+          it = scoped.erase(it);
+        else
+          ++it;
+      }
+      needsCompacting = false;
+    }
+    vector<Pending> toAdd;
+    toAdd.swap(pending);
+    for (Pending& elem : toAdd)
+      add(elem.obj, std::move(elem.fun), elem.scope);
+  }
+
+  void deliver(Subscribers& subscribers, Args... args) {
+    // Subscribers added during the delivery are pending, so the arrays don't grow here.
+    int size = subscribers.objs.size();
+    for (int i = 0; i < size; ++i)
+      if (subscribers.objs[i])
+        subscribers.funs[i](args...);
+  }
+
+  template <typename Tuple, size_t... I>
+  void publishTuple(Tuple& t, IndexSequence<I...>) {
+    publish(std::get<I>(t)...);
+  }
+
+  Subscribers global;
+  unordered_map<const void*, Subscribers> scoped;
+  unordered_map<const void*, Index> index;
+  vector<Pending> pending;
+  vector<tuple<typename std::decay<Args>::type...>> deferred;
+  int dispatching = 0;
+  bool needsCompacting = false;
+};
+
 #define EVENT(Name, ...)\
+typedef void Name##Signature(__VA_ARGS__);\
+EventChannel<Name##Signature> Name {channels};\
 template<typename... Ts>\
-void add##Name(Ts... ts) {\
-  for (auto elem : funs##Name)\
-    elem.second(ts...);\
+void add##Name(Ts&&... ts) {\
+  Name.publish(std::forward<Ts>(ts)...);\
 }\
-typedef function<void(__VA_ARGS__)> Fun##Name;\
-unordered_map<void*, Fun##Name> funs##Name;\
-void link##Name(void* obj, Fun##Name fun) {\
-  funs##Name[obj] = fun;\
-}\
-void unlink##Name(void* obj) {\
-  funs##Name.erase(obj);\
+template<typename... Ts>\
+void defer##Name(Ts&&... ts) {\
+  Name.defer(std::forward<Ts>(ts)...);\
 }
 
 class EventListener {
+  public:
+  /** Delivers all events deferred with EventChannel::defer(), in order of channels.*/
+  void flushDeferred();
+
+  private:
+  vector<EventChannelBase*> channels;
+
   public:
   EVENT(PickupEvent, const Creature*, const vector<Item*>& items);
   EVENT(DropEvent, const Creature*, const vector<Item*>& items);
@@ -65,14 +281,29 @@ class EventListener {
 
 extern EventListener GlobalEvents;
 
+/** Subscribes an object to a channel for the lifetime of the member.*/
+class EventSubscription {
+  public:
+  template <typename Channel>
+  EventSubscription(Channel& c, const void* obj, typename Channel::Fun fun) : channel(&c), object(obj) {
+    c.subscribe(obj, std::move(fun));
+  }
+
+  EventSubscription(const EventSubscription&) = delete;
+  EventSubscription& operator = (const EventSubscription&) = delete;
+
+  ~EventSubscription() {
+    channel->unsubscribe(object);
+  }
+
+  private:
+  EventChannelBase* channel;
+  const void* object;
+};
+
 #define REGISTER_HANDLER(Event, ...)\
-  ConstructorFunction __LINE__##Event##Runner123 = ConstructorFunction([=] {\
-      auto A = this;\
-      GlobalEvents.link##Event(this, bindMethod(&std::remove_reference<decltype(*A)>::type::on##Event, this));\
-  });\
-  DestructorFunction __LINE##Event##Runnder321 = DestructorFunction([=] {\
-      GlobalEvents.unlink##Event(this);\
-  });\
+  EventSubscription Event##Subscription {GlobalEvents.Event, this,\
+      bindMethod(&std::remove_reference<decltype(*this)>::type::on##Event, this)};\
   void on##Event(__VA_ARGS__)
 
 
@@ -17,14 +17,23 @@
 
 #include "field_of_view.h"
 #include "square.h"
+#include "profiler.h"
 
 template <class Archive> 
 void FieldOfView::serialize(Archive& ar, const unsigned int version) {
   if (Archive::is_saving::value) // don't save the visibility values, as they can be easily recomputed
-    visibility = Table<unique_ptr<Visibility>>(visibility.getBounds());
-  ar & SVAR(squares)
-     & SVAR(visibility)
-     & SVAR(vision);
+    clearCache();
+  if (version < 1) { // OBSOLETE
+    const Table<PSquare>* squares; // SERIAL(squares)
+    ar & SVAR(squares);
+  }
+  ar & SVAR(visibility);
+  if (version < 1) { // OBSOLETE
+    VisionId vision; // SERIAL(vision)
+    ar & SVAR(vision);
+  }
+  if (Archive::is_loading::value)
+    chunks = Table<vector<Vec2>>(getNumChunks(visibility.getBounds()));
 }
 
 SERIALIZABLE(FieldOfView);
@@ -32,7 +41,6 @@ SERIALIZABLE(FieldOfView);
 template <class Archive> 
 void FieldOfView::Visibility::serialize(Archive& ar, const unsigned int version) {
   ar& SVAR(visible)
-    & SVAR(visibleTiles)
     & SVAR(px)
     & SVAR(py);
 }
@@ -41,53 +49,225 @@ SERIALIZABLE(FieldOfView::Visibility);
 SERIALIZATION_CONSTRUCTOR_IMPL(FieldOfView);
 SERIALIZATION_CONSTRUCTOR_IMPL2(FieldOfView::Visibility, Visibility);
 
-FieldOfView::FieldOfView(const Table<PSquare>& s, VisionId v) 
-  : squares(&s), visibility(s.getWidth(), s.getHeight()), vision(v) {
+// Enough for about 120000 origins.
+static size_t cacheBudget = 64 * 1024 * 1024;
+
+void FieldOfView::setCacheBudget(size_t bytes) {
+  cacheBudget = bytes;
+}
+
+size_t FieldOfView::getCacheBudget() {
+  return cacheBudget;
+}
+
+FieldOfView::LruList& FieldOfView::getLru() {
+  static LruList lru;
+  return lru;
+}
+
+FieldOfView::CacheStats& FieldOfView::getMutableCacheStats() {
+  static CacheStats stats {0, 0, 0, 0};
+  return stats;
+}
+
+const FieldOfView::CacheStats& FieldOfView::getCacheStats() {
+  return getMutableCacheStats();
+}
+
+size_t FieldOfView::getEntrySize() {
+  // The list node holds the element and two pointers.
+  return sizeof(Visibility) + sizeof(LruList::value_type) + 2 * sizeof(void*) + sizeof(Vec2);
+}
+
+TransparencyMap::TransparencyMap(Rectangle b) : bounds(b), columnWords((b.getH() + 127) / 64 + 1),
+    bits(b.getW() * columnWords, 0) {
+}
+
+void TransparencyMap::setTransparent(Vec2 pos, bool transparent) {
+  // Columns start with a word of padding, so that reads up to 64 squares outside of the bounds are valid.
+  int index = pos.y - bounds.getPY() + 64;
+  uint64_t& word = bits[(pos.x - bounds.getPX()) * columnWords + index / 64];
+  uint64_t bit = uint64_t(1) << (index % 64);
+  if (transparent)
+    word |= bit;
+  else
+    word &= ~bit;
+}
+
+bool TransparencyMap::isTransparent(Vec2 pos) const {
+  return pos.inRectangle(bounds) && (getColumn(pos.x, pos.y) & 1);
+}
+
+uint64_t TransparencyMap::getColumn(int x, int y) const {
+  if (x < bounds.getPX() || x >= bounds.getKX())
+    return 0;
+  int index = y - bounds.getPY() + 64;
+  const uint64_t* column = &bits[(x - bounds.getPX()) * columnWords];
+  int shift = index % 64;
+  if (shift == 0)
+    return column[index / 64];
+  return (column[index / 64] >> shift) | (column[index / 64 + 1] << (64 - shift));
+}
+
+FieldOfView::FieldOfView(const TransparencyMap* t, Rectangle bounds) 
+  : transparency(t), visibility(bounds), chunks(getNumChunks(bounds)) {
+}
+
+void FieldOfView::setTransparency(const TransparencyMap* t) {
+  transparency = t;
+}
+
+FieldOfView::FieldOfView(FieldOfView&& o) : transparency(o.transparency), visibility(std::move(o.visibility)),
+    chunks(std::move(o.chunks)), numCached(o.numCached) {
+  o.numCached = 0;
+  if (numCached > 0)
+    for (Vec2 v : visibility.getBounds())
+      if (visibility[v])
+        visibility[v]->lruPos->first = this;
+}
+
+FieldOfView& FieldOfView::operator = (FieldOfView&& o) {
+  clearCache();
+  transparency = o.transparency;
+  visibility = std::move(o.visibility);
+  chunks = std::move(o.chunks);
+  numCached = o.numCached;
+  o.numCached = 0;
+  if (numCached > 0)
+    for (Vec2 v : visibility.getBounds())
+      if (visibility[v])
+        visibility[v]->lruPos->first = this;
+  return *this;
+}
+
+FieldOfView::~FieldOfView() {
+  clearCache();
+}
+
+Vec2 FieldOfView::getNumChunks(Rectangle bounds) {
+  return (bounds.getSize() + Vec2(chunkSize - 1, chunkSize - 1)) / chunkSize;
+}
+
+Vec2 FieldOfView::getChunk(Vec2 pos) const {
+  return (pos - visibility.getBounds().getTopLeft()) / chunkSize;
+}
+
+void FieldOfView::removeFromCache(Vec2 pos) {
+  vector<Vec2>& chunk = chunks[getChunk(pos)];
+  int slot = visibility[pos]->chunkSlot;
+  chunk[slot] = chunk.back();
+  visibility[chunk[slot]]->chunkSlot = slot;
+  chunk.pop_back();
+  getLru().erase(visibility[pos]->lruPos);
+  visibility[pos].reset();
+  --numCached;
+  getMutableCacheStats().residentBytes -= getEntrySize();
+}
+
+void FieldOfView::clearCache() {
+  if (numCached > 0)
+    for (Vec2 v : visibility.getBounds())
+      if (visibility[v])
+        removeFromCache(v);
+}
+
+FieldOfView::Visibility& FieldOfView::getVisibility(Vec2 from) {
+  LruList& lru = getLru();
+  CacheStats& stats = getMutableCacheStats();
+  if (visibility[from]) {
+    ++stats.numHits;
+    lru.splice(lru.begin(), lru, visibility[from]->lruPos);
+    return *visibility[from];
+  }
+  ++stats.numMisses;
+  visibility[from].reset(new Visibility(*transparency, from.x, from.y));
+  lru.push_front({this, from});
+  visibility[from]->lruPos = lru.begin();
+  vector<Vec2>& chunk = chunks[getChunk(from)];
+  visibility[from]->chunkSlot = chunk.size();
+  chunk.push_back(from);
+  ++numCached;
+  stats.residentBytes += getEntrySize();
+  // The new entry stays, even if it doesn't fit in the budget on its own.
+  while (stats.residentBytes > cacheBudget && lru.size() > 1) {
+    auto last = lru.back();
+    last.first->removeFromCache(last.second);
+    ++stats.numEvicted;
+  }
+  return *visibility[from];
 }
 
 bool FieldOfView::canSee(Vec2 from, Vec2 to) {
   if ((from - to).lengthD() > sightRange)
     return false;
-  if (!visibility[from])
-    visibility[from].reset(new Visibility(*squares, vision, from.x, from.y));
-  return visibility[from]->checkVisible(to.x - from.x, to.y - from.y);
+  return getVisibility(from).checkVisible(to.x - from.x, to.y - from.y);
 }
   
 void FieldOfView::squareChanged(Vec2 pos) {
-  vector<Vec2> updateList;
-  if (!visibility[pos])
-    visibility[pos].reset(new Visibility(*squares, vision, pos.x, pos.y));
-  vector<Vec2> visible = visibility[pos]->getVisibleTiles();
-  for (Vec2 v : visible)
-    if (visibility[v] && visibility[v]->checkVisible(pos.x - v.x, pos.y - v.y)) {
-      visibility[v].reset();
+  if (numCached == 0)
+    return;
+  Vec2 range(sightRange, sightRange);
+  Vec2 from = getChunk(pos - range);
+  Vec2 to = getChunk(pos + range);
+  for (int x = max(0, from.x); x <= min(chunks.getWidth() - 1, to.x); ++x)
+    for (int y = max(0, from.y); y <= min(chunks.getHeight() - 1, to.y); ++y) {
+      vector<Vec2>& chunk = chunks[x][y];
+      // Removing an origin moves the last one into its slot, so the list is scanned backwards.
+      for (int i = int(chunk.size()) - 1; i >= 0; --i) {
+        Vec2 v = chunk[i];
+        if (visibility[v]->checkVisibleAround(pos.x - v.x, pos.y - v.y))
+          removeFromCache(v);
+      }
     }
 }
 
 void FieldOfView::Visibility::setVisible(int x, int y) {
-  if (!visible[x + sightRange][y + sightRange] && x * x + y * y <= sightRange * sightRange) {
-    visible[x + sightRange][y + sightRange] = 1;
-    visibleTiles.push_back(Vec2(px + x, py + y));
+  if (x * x + y * y <= sightRange * sightRange) {
+    int index = (x + sightRange) * width + y + sightRange;
+    visible[index / 64] |= uint64_t(1) << (index % 64);
   }
 }
 
 static int totalIter = 0;
 static int numSamples = 0;
 
-FieldOfView::Visibility::Visibility(const Table<PSquare>& squares, VisionId vision, int x, int y) : px(x), py(y) {
-  memset(visible, 0, (2 * sightRange + 1) * (2 * sightRange + 1));
-  calculate(2 * sightRange, 2 * sightRange,2 * sightRange, 2,-1,1,1,1,
-      [&](int px, int py) { return !squares[x + px][y + py]->canSeeThru(vision); },
-      [&](int px, int py) { setVisible(px ,py); });
-  calculate(2 * sightRange, 2 * sightRange,2 * sightRange, 2,-1,1,1,1,
-      [&](int px, int py) { return !squares[x + py][y - px]->canSeeThru(vision); },
-      [&](int px, int py) { setVisible(py, -px); });
-  calculate(2 * sightRange, 2 * sightRange,2 * sightRange,2,-1,1,1,1,
-      [&](int px, int py) { return !squares[x - px][y - py]->canSeeThru(vision); },
-      [&](int px, int py) { setVisible(-px, -py); });
-  calculate(2 * sightRange, 2 * sightRange,2 * sightRange,2,-1,1,1,1,
-      [&](int px, int py) { return !squares[x - py][y + px]->canSeeThru(vision); },
-      [&](int px, int py) { setVisible(-py, px); });
+/** Maps coordinates of the quadrant that is scanned upwards to one of the four quadrants.*/
+template <int Rotation>
+static inline void rotate(int& x, int& y) {
+  int tmp = x;
+  switch (Rotation) {
+    case 0: break;
+    case 1: x = y; y = -tmp; break;
+    case 2: x = -x; y = -y; break;
+    case 3: x = -y; y = tmp; break;
+  }
+}
+
+/** Bitmap of the squares around the origin that block vision, one row per x coordinate.*/
+struct FieldOfView::Visibility::Blocking {
+  Blocking(const TransparencyMap& transparency, int x, int y) {
+    const uint64_t mask = (uint64_t(1) << width) - 1;
+    for (int i : Range(width))
+      blocked[i] = ~transparency.getColumn(x + i - sightRange, y - sightRange) & mask;
+  }
+
+  template <int Rotation>
+  bool get(int x, int y) const {
+    rotate<Rotation>(x, y);
+    return (blocked[x + sightRange] >> (y + sightRange)) & 1;
+  }
+
+  uint64_t blocked[width];
+};
+
+FieldOfView::Visibility::Visibility(const TransparencyMap& transparency, int x, int y) : px(x), py(y) {
+  PROFILE_ZONE("FieldOfView::Visibility");
+  memset(visible, 0, sizeof(visible));
+  Blocking blocking(transparency, x, y);
+  calculate<0>(blocking, 2 * sightRange, 2 * sightRange, 2 * sightRange, 2, -1, 1, 1, 1);
+  calculate<1>(blocking, 2 * sightRange, 2 * sightRange, 2 * sightRange, 2, -1, 1, 1, 1);
+  calculate<2>(blocking, 2 * sightRange, 2 * sightRange, 2 * sightRange, 2, -1, 1, 1, 1);
+  calculate<3>(blocking, 2 * sightRange, 2 * sightRange, 2 * sightRange, 2, -1, 1, 1, 1);
   setVisible(0, 0);
 /*  ++numSamples;
   totalIter += visibleTiles.size();
@@ -95,20 +275,23 @@ FieldOfView::Visibility::Visibility(const Table<PSquare>& squares, VisionId visi
     Debug() << numSamples << " iterations " << totalIter / numSamples << " avg";*/
 }
 
-const vector<Vec2>& FieldOfView::Visibility::getVisibleTiles() const {
-  return visibleTiles;
+vector<Vec2> FieldOfView::Visibility::getVisibleTiles() const {
+  vector<Vec2> ret;
+  for (int i : Range(numWords))
+    for (uint64_t word = visible[i]; word; word &= word - 1) {
+      int index = i * 64 + __builtin_ctzll(word);
+      ret.push_back(Vec2(px + index / width - sightRange, py + index % width - sightRange));
+    }
+  return ret;
 }
 
-const vector<Vec2>& FieldOfView::getVisibleTiles(Vec2 from) {
-  if (!visibility[from]) {
-    visibility[from].reset(new Visibility(*squares, vision, from.x, from.y));
-  }
-  return visibility[from]->getVisibleTiles();
+vector<Vec2> FieldOfView::getVisibleTiles(Vec2 from) {
+  return getVisibility(from).getVisibleTiles();
 }
 
-
-void FieldOfView::Visibility::calculate(int left, int right, int up, int h, int x1, int y1, int x2, int y2,
-    function<bool (int, int)> isBlocking, function<void (int, int)> setVisible){
+template <int Rotation>
+void FieldOfView::Visibility::calculate(const Blocking& blocking, int left, int right, int up, int h,
+    int x1, int y1, int x2, int y2) {
   if (y2*x1>=y1*x2) return;
   if (h>up) return;
   int leftx=x1, lefty=y1, rightx=x2, righty=y2;
@@ -125,7 +308,7 @@ void FieldOfView::Visibility::calculate(int left, int right, int up, int h, int
   if(right_b % 2)
     --right_b;
 
-  if(left_b>=-left && left_b<=right && isBlocking(left_b/2,h/2)){
+  if(left_b>=-left && left_b<=right && blocking.get<Rotation>(left_b/2,h/2)){
     leftx=left_b+1;
     lefty=h+(left_b>=0?-1:1);
   }
@@ -133,22 +316,34 @@ void FieldOfView::Visibility::calculate(int left, int right, int up, int h, int
   if(right_v>right) right_v=right;
   bool prevBlocking = false;
   for (int i=left_v/2;i<=right_v/2;++i){
-    setVisible(i, h / 2);
-    bool blocking = isBlocking(i, h / 2);
-    if(i > left_v / 2 && blocking && !prevBlocking)
-      calculate(left, right, up, h + 2, leftx, lefty, i * 2 - 1, h + (i<=0 ? -1:1), isBlocking, setVisible);
-    if(blocking){
+    int vx = i, vy = h / 2;
+    rotate<Rotation>(vx, vy);
+    setVisible(vx, vy);
+    bool isBlocking = blocking.get<Rotation>(i, h / 2);
+    if(i > left_v / 2 && isBlocking && !prevBlocking)
+      calculate<Rotation>(blocking, left, right, up, h + 2, leftx, lefty, i * 2 - 1, h + (i<=0 ? -1:1));
+    if(isBlocking){
       leftx=i*2+1;
       lefty=h+(i>=0?-1:1);
     }
-    prevBlocking = blocking;
+    prevBlocking = isBlocking;
   }
-  calculate(left, right, up, h + 2, leftx, lefty, rightx, righty, isBlocking, setVisible);
+  calculate<Rotation>(blocking, left, right, up, h + 2, leftx, lefty, rightx, righty);
+}
+
+bool FieldOfView::Visibility::checkVisibleAround(int x, int y) const {
+  for (int dx = -1; dx <= 1; ++dx)
+    for (int dy = -1; dy <= 1; ++dy)
+      if (checkVisible(x + dx, y + dy))
+        return true;
+  return false;
 }
 
 bool FieldOfView::Visibility::checkVisible(int x, int y) const {
-  return x >= -sightRange && y >= -sightRange && x <= sightRange && y <= sightRange && 
-    visible[sightRange + x][sightRange + y] == 1;
+  if (x < -sightRange || y < -sightRange || x > sightRange || y > sightRange)
+    return false;
+  int index = (x + sightRange) * width + y + sightRange;
+  return (visible[index / 64] >> (index % 64)) & 1;
 }
 
 
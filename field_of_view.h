@@ -20,47 +20,114 @@
 
 class Square;
 
+/**
+  * Squares of a level that can be seen through, packed one bit per square in a column of words
+  * for each x coordinate, so that a range of a column can be read with a couple of shifts.
+  */
+class TransparencyMap {
+  public:
+  TransparencyMap() {}
+  TransparencyMap(Rectangle bounds);
+  void setTransparent(Vec2 pos, bool);
+  bool isTransparent(Vec2 pos) const;
+  /** Bit i is set if the square (x, y + i) is transparent. Squares outside of the bounds aren't.
+      The y coordinate may be up to 64 squares outside of the bounds.*/
+  uint64_t getColumn(int x, int y) const;
+
+  private:
+  Rectangle bounds;
+  int columnWords = 0;
+  vector<uint64_t> bits;
+};
+
+/**
+  * Computes and caches the squares visible from each origin. The visibility of all levels is kept in
+  * one cache, and the least recently used origins are dropped when it takes more than its budget.
+  */
 class FieldOfView {
   public:
-  FieldOfView(const Table<PSquare>& squares, VisionId);
+  FieldOfView(const TransparencyMap*, Rectangle bounds);
+  FieldOfView(FieldOfView&&);
+  FieldOfView& operator = (FieldOfView&&);
+  ~FieldOfView();
   bool canSee(Vec2 from, Vec2 to);
-  const vector<Vec2>& getVisibleTiles(Vec2 from);
+  vector<Vec2> getVisibleTiles(Vec2 from);
   void squareChanged(Vec2 pos);
+  /** Needs to be called after loading, as the map is owned and rebuilt by the level.*/
+  void setTransparency(const TransparencyMap*);
 
   SERIALIZATION_DECL(FieldOfView);
 
   const static int sightRange = 30;
 
-  private:
+  /** Sets the memory budget of the cache in bytes, shared by all levels.*/
+  static void setCacheBudget(size_t bytes);
+  static size_t getCacheBudget();
+
+  struct CacheStats {
+    long long numHits;
+    long long numMisses;
+    long long numEvicted;
+    size_t residentBytes;
+  };
 
+  static const CacheStats& getCacheStats();
+
+  private:
+  typedef list<pair<FieldOfView*, Vec2>> LruList;
 
   class Visibility {
     public:
 
     bool checkVisible(int x,int y) const;
-    const vector<Vec2>& getVisibleTiles() const;
+    /** Checks if the square or any of its neighbors is visible. The scan also looks at squares next
+        to the visible ones, so only then a change of the square may affect the visibility.*/
+    bool checkVisibleAround(int x, int y) const;
+    vector<Vec2> getVisibleTiles() const;
 
-    Visibility(const Table<PSquare>& squares, VisionId, int x, int y);
-    Visibility(Visibility&&) = default;
-    Visibility& operator = (Visibility&&) = default;
+    Visibility(const TransparencyMap&, int x, int y);
 
     SERIALIZATION_DECL(Visibility);
 
+    /** Position in the cache's list of origins, most recently used first.*/
+    LruList::iterator lruPos;
+    /** Position in the list of cached origins of its chunk.*/
+    int chunkSlot = -1;
+
     private:
-    char SERIAL(visible)[sightRange * 2 + 1][sightRange * 2 + 1];
-    vector<Vec2> SERIAL(visibleTiles);
-    void calculate(int,int,int,int, int, int, int, int,
-        function<bool (int, int)> isBlocking,
-        function<void (int, int)> setVisible);
+    static const int width = sightRange * 2 + 1;
+    static const int numWords = (width * width + 63) / 64;
+    /** One bit per square of the (2 * sightRange + 1)^2 area around the origin.*/
+    uint64_t SERIAL(visible)[numWords];
+    struct Blocking;
+    /** Scans one quadrant, rotated to face upwards, so that the coordinate mapping is inlined.*/
+    template <int Rotation>
+    void calculate(const Blocking&, int left, int right, int up, int h, int x1, int y1, int x2, int y2);
     void setVisible(int, int);
 
     int SERIAL(px);
     int SERIAL(py);
   };
-  
-  const Table<PSquare>* SERIAL(squares);
+
+  static LruList& getLru();
+  static CacheStats& getMutableCacheStats();
+  static size_t getEntrySize();
+  Visibility& getVisibility(Vec2 from);
+  void removeFromCache(Vec2 pos);
+  void clearCache();
+  static Vec2 getNumChunks(Rectangle bounds);
+  Vec2 getChunk(Vec2 pos) const;
+
+  /** Cached origins are also listed by chunk, so that all origins that may see a square are found
+      without computing the square's own visibility.*/
+  static const int chunkSize = 16;
+
+  const TransparencyMap* transparency = nullptr;
   Table<unique_ptr<Visibility>> SERIAL(visibility);
-  VisionId SERIAL(vision);
+  Table<vector<Vec2>> chunks;
+  int numCached = 0;
 };
 
+BOOST_CLASS_VERSION(FieldOfView, 1)
+
 #endif
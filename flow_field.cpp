@@ -0,0 +1,79 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+
+
+#include "stdafx.h"
+
+#include "flow_field.h"
+#include "shortest_path.h"
+#include "profiler.h"
+
+FlowField::FlowField(Rectangle b, vector<Vec2> t, EntryFun f) : bounds(b), targets(t), entryFun(f),
+    distance(bounds, ShortestPath::infinity), done(bounds, false) {
+  for (Vec2 v : targets) {
+    CHECK(v.inRectangle(bounds));
+    distance[v] = 0;
+    queue.push({v, 0}, 0);
+  }
+}
+
+const vector<Vec2>& FlowField::getTargets() const {
+  return targets;
+}
+
+void FlowField::expand() {
+  QueueElem elem = queue.pop();
+  Vec2 pos = elem.pos;
+  if (done[pos] || elem.dist > distance[pos])
+    return;
+  done[pos] = true;
+  // Squares are reached from the neighbors by entering pos.
+  double dist = elem.dist + entryFun(pos);
+  if (dist >= ShortestPath::infinity)
+    return;
+  for (Vec2 dir : Vec2::directions8()) {
+    Vec2 next = pos + dir;
+    if (next.inRectangle(bounds) && dist < distance[next]) {
+      distance[next] = dist;
+      queue.push({next, dist}, getBucketKey(dist));
+    }
+  }
+}
+
+double FlowField::getDistance(Vec2 pos) {
+  if (!pos.inRectangle(bounds))
+    return ShortestPath::infinity;
+  if (!done[pos]) {
+    PROFILE_ZONE("FlowField::expand");
+    while (!done[pos] && !queue.isEmpty())
+      expand();
+  }
+  return done[pos] ? distance[pos] : ShortestPath::infinity;
+}
+
+vector<Vec2> FlowField::getNextMoves(Vec2 pos) {
+  double dist = getDistance(pos);
+  vector<pair<double, Vec2>> moves;
+  if (dist < ShortestPath::infinity)
+    for (Vec2 next : pos.neighbors8())
+      if (next.inRectangle(bounds) && done[next] && distance[next] < dist)
+        moves.push_back({distance[next] + entryFun(next), next});
+  sort(moves.begin(), moves.end());
+  return transform2<Vec2>(moves, [](const pair<double, Vec2>& m) { return m.second; });
+}
+
+bool FlowField::isReached(Vec2 pos) const {
+  return pos.inRectangle(bounds) && done[pos];
+}
@@ -0,0 +1,68 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+
+
+#ifndef _FLOW_FIELD_H
+#define _FLOW_FIELD_H
+
+#include "util.h"
+#include "shortest_path.h"
+#include "bucket_queue.h"
+
+/** Identifies targets that rarely change, eg. the squares of a collective, so that their cached field is
+    found without comparing the targets. The version must change whenever the targets do.*/
+struct FlowFieldKey {
+  const void* owner;
+  int version;
+};
+
+/**
+  * Distances to the closest of a set of targets, which any number of creatures can follow.
+  * The field is computed by a multi-source Dijkstra that is expanded lazily, only until the squares
+  * that were asked about are reached, so it costs no more than one search from the farthest creature.
+  */
+class FlowField {
+  public:
+  FlowField(Rectangle bounds, vector<Vec2> targets, EntryFun entryFun);
+
+  const vector<Vec2>& getTargets() const;
+
+  /** Cost of getting from the square to the closest target, ShortestPath::infinity if unreachable.*/
+  double getDistance(Vec2);
+
+  /** Neighbors that lie on a path towards the targets, best first.*/
+  vector<Vec2> getNextMoves(Vec2);
+
+  /** Returns true if the field has already used the square's entry cost, so a change to it makes
+      the field invalid.*/
+  bool isReached(Vec2) const;
+
+  private:
+  void expand();
+
+  struct QueueElem {
+    Vec2 pos;
+    double dist;
+  };
+
+  Rectangle bounds;
+  vector<Vec2> targets;
+  EntryFun entryFun;
+  Table<double> distance;
+  Table<bool> done;
+  BucketQueue<QueueElem> queue;
+};
+
+#endif
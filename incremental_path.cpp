@@ -0,0 +1,179 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+
+
+#include "stdafx.h"
+
+#include "incremental_path.h"
+#include "shortest_path.h"
+
+// Tolerance when comparing distances along the tree.
+const double epsilon = 0.0001;
+
+IncrementalPath::Node::Node() : g(ShortestPath::infinity), rhs(ShortestPath::infinity) {
+}
+
+IncrementalPath::IncrementalPath(Rectangle b, EntryFun e, Vec2 s, Vec2 g)
+    : bounds(b), entryFun(e), start(s), goal(g), nodes(bounds) {
+  CHECK(start.inRectangle(bounds) && goal.inRectangle(bounds));
+  for (Vec2 v : bounds)
+    nodes[v].pos = v;
+  Node& node = nodes[start];
+  node.rhs = 0;
+  queue.push(&node, getKey(node));
+}
+
+void IncrementalPath::setGoal(Vec2 pos) {
+  CHECK(pos.inRectangle(bounds));
+  if (pos == goal)
+    return;
+  goal = pos;
+  // The keys of all queued squares depend on the goal.
+  queue.assign(queue.getElems(), [this](Node* node) { return getKey(*node); });
+}
+
+void IncrementalPath::updateSquare(Vec2 pos) {
+  if (pos.inRectangle(bounds))
+    updateNode(nodes[pos]);
+}
+
+void IncrementalPath::setCost(Vec2 pos, double cost) {
+  if (pos.inRectangle(bounds)) {
+    costs[pos] = cost;
+    updateNode(nodes[pos]);
+  }
+}
+
+void IncrementalPath::resetCost(Vec2 pos) {
+  if (costs.erase(pos))
+    updateNode(nodes[pos]);
+}
+
+vector<Vec2> IncrementalPath::getCostSquares() const {
+  return getKeys(costs);
+}
+
+double IncrementalPath::getEntryCost(Vec2 pos) const {
+  auto cost = costs.find(pos);
+  return cost == costs.end() ? entryFun(pos) : cost->second;
+}
+
+double IncrementalPath::getG(Vec2 pos) const {
+  if (!pos.inRectangle(bounds))
+    return ShortestPath::infinity;
+  return nodes[pos].g;
+}
+
+IncrementalPath::Key IncrementalPath::getKey(const Node& node) const {
+  double dist = min(node.g, node.rhs);
+  // Entry costs are at least 1, so the 8-directional length is a consistent heuristic. It must not be
+  // inflated, otherwise squares along the path can be left inconsistent.
+  return {dist + (goal - node.pos).length8(), dist};
+}
+
+void IncrementalPath::updateNode(Node& node) {
+  if (node.pos != start) {
+    node.rhs = ShortestPath::infinity;
+    double entry = getEntryCost(node.pos);
+    if (entry < ShortestPath::infinity)
+      for (Vec2 dir : Vec2::directions8())
+        node.rhs = min(node.rhs, getG(node.pos + dir) + entry);
+  }
+  if (node.g != node.rhs) {
+    if (node.slot >= 0)
+      queue.updateKey(node.slot, getKey(node));
+    else
+      queue.push(&node, getKey(node));
+  } else if (node.slot >= 0)
+    queue.remove(node.slot);
+}
+
+void IncrementalPath::computeShortestPath() {
+  Node& goalNode = nodes[goal];
+  while (!queue.isEmpty() && (queue.getTopKey() < getKey(goalNode) || goalNode.g != goalNode.rhs)) {
+    Node* node = queue.pop();
+    ++numExpanded;
+    if (node->g > node->rhs)
+      node->g = node->rhs;
+    else {
+      node->g = ShortestPath::infinity;
+      updateNode(*node);
+    }
+    for (Vec2 dir : Vec2::directions8()) {
+      Vec2 next = node->pos + dir;
+      if (next.inRectangle(bounds))
+        updateNode(nodes[next]);
+    }
+  }
+}
+
+optional<vector<Vec2>> IncrementalPath::getPath(Vec2 pos) {
+  computeShortestPath();
+  double goalDist = getG(goal);
+  double posDist = getG(pos);
+  if (goalDist >= ShortestPath::infinity || posDist > goalDist)
+    return none;
+  // Walk back from the goal along the edges of all shortest paths, until pos is found. Squares
+  // closer to the start than pos can't lead to it.
+  ++visitedCounter;
+  Node& goalNode = nodes[goal];
+  goalNode.visited = visitedCounter;
+  vector<Node*> stack {&goalNode};
+  while (!stack.empty()) {
+    Node* node = stack.back();
+    stack.pop_back();
+    if (node->pos == pos) {
+      vector<Vec2> ret {pos};
+      while (ret.back() != goal)
+        ret.push_back(nodes[ret.back()].next);
+      return vector<Vec2>(ret.rbegin(), ret.rend());
+    }
+    double entry = getEntryCost(node->pos);
+    for (Vec2 dir : Vec2::directions8()) {
+      Vec2 prevPos = node->pos + dir;
+      if (prevPos.inRectangle(bounds)) {
+        Node& prev = nodes[prevPos];
+        if (prev.visited != visitedCounter && prev.g >= posDist - epsilon
+            && fabs(prev.g + entry - node->g) < epsilon) {
+          prev.visited = visitedCounter;
+          prev.next = node->pos;
+          stack.push_back(&prev);
+        }
+      }
+    }
+  }
+  return none;
+}
+
+Vec2 IncrementalPath::getStart() const {
+  return start;
+}
+
+Vec2 IncrementalPath::getGoal() const {
+  return goal;
+}
+
+Rectangle IncrementalPath::getBounds() const {
+  return bounds;
+}
+
+int IncrementalPath::getNumExpanded() const {
+  return numExpanded;
+}
+
+size_t IncrementalPath::getMemoryUsage() const {
+  return sizeof(*this) + bounds.getW() * bounds.getH() * sizeof(Node)
+      + queue.getSize() * (sizeof(Node*) + sizeof(Key)) + costs.size() * (sizeof(Vec2) + sizeof(double));
+}
@@ -0,0 +1,103 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+
+
+#ifndef _INCREMENTAL_PATH_H
+#define _INCREMENTAL_PATH_H
+
+#include "util.h"
+#include "shortest_path.h"
+#include "indexed_heap.h"
+
+/**
+  * Lifelong Planning A* (LPA*) from a fixed start square. The search tree is kept between queries,
+  * so after the goal moves or the cost of some squares changes, only the part of the tree that is
+  * affected is searched again. The start is the root of the tree, so a creature walking along the
+  * path can keep using it, as long as its position stays on a shortest path to the goal.
+  * The tree takes a table over the whole bounds, so they should be kept small.
+  */
+class IncrementalPath {
+  public:
+  IncrementalPath(Rectangle bounds, EntryFun entryFun, Vec2 start, Vec2 goal);
+
+  /** Moves the goal, which must be within the bounds.*/
+  void setGoal(Vec2);
+
+  /** Notifies that the entry cost of the square changed.*/
+  void updateSquare(Vec2);
+
+  /** Sets the entry cost of the square, which is used instead of the entry function from now on.*/
+  void setCost(Vec2, double cost);
+
+  /** Goes back to the entry function for a square passed to setCost().*/
+  void resetCost(Vec2);
+
+  /** Squares whose cost was set with setCost().*/
+  vector<Vec2> getCostSquares() const;
+
+  /** Returns a shortest path from the start to the goal that passes through \paramname{pos}, ordered
+      from the goal to \paramname{pos}. Returns none if the goal is unreachable, or if \paramname{pos}
+      doesn't lie on any shortest path.*/
+  optional<vector<Vec2>> getPath(Vec2 pos);
+
+  Vec2 getStart() const;
+  Vec2 getGoal() const;
+  Rectangle getBounds() const;
+
+  /** Number of squares popped from the queue since the tree was created.*/
+  int getNumExpanded() const;
+
+  /** Approximate number of bytes held by the search tree.*/
+  size_t getMemoryUsage() const;
+
+  private:
+  struct Node {
+    Node();
+    Vec2 pos;
+    /** Distance from the start as of the last expansion, and its one step lookahead.*/
+    double g;
+    double rhs;
+    int slot = -1;
+    int visited = 0;
+    /** Next square towards the goal, set while looking for a path.*/
+    Vec2 next;
+  };
+
+  struct SlotFun {
+    int& operator()(Node* node) const {
+      return node->slot;
+    }
+  };
+
+  typedef pair<double, double> Key;
+
+  double getG(Vec2) const;
+  double getEntryCost(Vec2) const;
+  Key getKey(const Node&) const;
+  void updateNode(Node&);
+  void computeShortestPath();
+
+  Rectangle bounds;
+  EntryFun entryFun;
+  unordered_map<Vec2, double> costs;
+  Vec2 start;
+  Vec2 goal;
+  Table<Node> nodes;
+  IndexedHeap<Node*, Key, SlotFun> queue;
+  int numExpanded = 0;
+  int visitedCounter = 0;
+};
+
+#endif
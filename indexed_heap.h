@@ -0,0 +1,165 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+
+#ifndef _INDEXED_HEAP_H
+#define _INDEXED_HEAP_H
+
+#include "util.h"
+
+/**
+  * D-ary min-heap, in which every element knows its current slot. SlotFun(elem) must return
+  * a reference to an int stored in the element, which is kept up to date by the heap, so that
+  * an element can be removed or have its key changed in O(log n).
+  * Elements and keys are kept in separate arrays, so sifting only touches the keys.
+  */
+template <class T, class Key, class SlotFun, int D = 4>
+class IndexedHeap {
+  public:
+  IndexedHeap(SlotFun f = SlotFun()) : slotFun(f) {}
+
+  int getSize() const {
+    return elems.size();
+  }
+
+  bool isEmpty() const {
+    return elems.empty();
+  }
+
+  const T& getTop() const {
+    CHECK(!elems.empty());
+    return elems[0];
+  }
+
+  const Key& getTopKey() const {
+    CHECK(!keys.empty());
+    return keys[0];
+  }
+
+  const Key& getKey(int slot) const {
+    return keys[slot];
+  }
+
+  /** Elements in heap order.*/
+  const vector<T>& getElems() const {
+    return elems;
+  }
+
+  void push(T elem, const Key& key) {
+    elems.push_back(std::move(elem));
+    keys.push_back(key);
+    siftUp(elems.size() - 1);
+  }
+
+  T pop() {
+    return remove(0);
+  }
+
+  T remove(int slot) {
+    CHECK(slot >= 0 && slot < elems.size()) << "Bad heap slot " << slot;
+    T ret = std::move(elems[slot]);
+    slotFun(ret) = -1;
+    int last = elems.size() - 1;
+    if (slot < last) {
+      elems[slot] = std::move(elems[last]);
+      keys[slot] = keys[last];
+      elems.pop_back();
+      keys.pop_back();
+      if (siftUp(slot) == slot)
+        siftDown(slot);
+    } else {
+      elems.pop_back();
+      keys.pop_back();
+    }
+    return ret;
+  }
+
+  /** Works both for decreasing and increasing the key.*/
+  void updateKey(int slot, const Key& key) {
+    CHECK(slot >= 0 && slot < elems.size()) << "Bad heap slot " << slot;
+    bool decrease = key < keys[slot];
+    keys[slot] = key;
+    if (decrease)
+      siftUp(slot);
+    else
+      siftDown(slot);
+  }
+
+  /** Replaces the contents of the heap and restores the heap property in O(n).*/
+  template <class KeyFun>
+  void assign(vector<T> e, KeyFun keyFun) {
+    elems = std::move(e);
+    keys.clear();
+    for (int i : All(elems)) {
+      keys.push_back(keyFun(elems[i]));
+      slotFun(elems[i]) = i;
+    }
+    for (int i = int(elems.size()) / D; i >= 0; --i)
+      siftDown(i);
+  }
+
+  private:
+  void moveTo(int from, int to) {
+    elems[to] = std::move(elems[from]);
+    keys[to] = keys[from];
+    slotFun(elems[to]) = to;
+  }
+
+  int siftUp(int slot) {
+    T elem = std::move(elems[slot]);
+    Key key = keys[slot];
+    while (slot > 0) {
+      int parent = (slot - 1) / D;
+      if (!(key < keys[parent]))
+        break;
+      moveTo(parent, slot);
+      slot = parent;
+    }
+    elems[slot] = std::move(elem);
+    keys[slot] = key;
+    slotFun(elems[slot]) = slot;
+    return slot;
+  }
+
+  int siftDown(int slot) {
+    if (slot >= elems.size())
+      return slot;
+    T elem = std::move(elems[slot]);
+    Key key = keys[slot];
+    int size = elems.size();
+    while (1) {
+      int first = slot * D + 1;
+      if (first >= size)
+        break;
+      int best = first;
+      for (int i = first + 1; i < min(first + D, size); ++i)
+        if (keys[i] < keys[best])
+          best = i;
+      if (!(keys[best] < key))
+        break;
+      moveTo(best, slot);
+      slot = best;
+    }
+    elems[slot] = std::move(elem);
+    keys[slot] = key;
+    slotFun(elems[slot]) = slot;
+    return slot;
+  }
+
+  vector<T> elems;
+  vector<Key> keys;
+  SlotFun slotFun;
+};
+
+#endif
@@ -135,6 +135,10 @@ void Item::tick(double time, Level* level, Vec2 position) {
   specialTick(time, level, position);
 }
 
+bool Item::needsTicking() const {
+  return fire.isBurning() || needsSpecialTick();
+}
+
 void Item::onHitSquareMessage(Vec2 position, Square* s, bool plural) {
   if (fragile) {
     s->getLevel()->globalMessage(position,
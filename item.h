@@ -99,6 +99,8 @@ class Item : private ItemAttributes, public Renderable, public UniqueEntity<Item
   int getAttr(AttrType) const;
 
   void tick(double time, Level*, Vec2 position);
+  /** Returns false if tick() has nothing to do until something happens to the item.*/
+  bool needsTicking() const;
   
   string getApplyMsgThirdPerson(bool blind) const;
   string getApplyMsgFirstPerson(bool blind) const;
@@ -146,6 +148,7 @@ class Item : private ItemAttributes, public Renderable, public UniqueEntity<Item
 
   protected:
   virtual void specialTick(double time, Level*, Vec2 position) {}
+  virtual bool needsSpecialTick() const { return false; }
   void setName(const string& name);
   bool SERIAL(discarded) = false;
 
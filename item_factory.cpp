@@ -57,6 +57,10 @@ class FireScroll : public Item {
     }
   }
 
+  virtual bool needsSpecialTick() const override {
+    return set;
+  }
+
   template <class Archive> 
   void serialize(Archive& ar, const unsigned int version) {
     ar& SUBCLASS(Item)
@@ -106,6 +110,10 @@ class AmuletOfWarning : public Item {
         owner->playerMessage(getTheName() + " vibrates");
     }
   }
+
+  virtual bool needsSpecialTick() const override {
+    return true;
+  }
  
   template <class Archive> 
   void serialize(Archive& ar, const unsigned int version) {
@@ -135,6 +143,10 @@ class AmuletOfHealing : public Item {
     } else 
       lastTick = -1;
   }
+
+  virtual bool needsSpecialTick() const override {
+    return lastTick != -1;
+  }
  
   template <class Archive> 
   void serialize(Archive& ar, const unsigned int version) {
@@ -279,6 +291,10 @@ class Corpse : public Item {
     }
   }
 
+  virtual bool needsSpecialTick() const override {
+    return !corpseInfo.isSkeleton;
+  }
+
   virtual optional<CorpseInfo> getCorpseInfo() const override { 
     return corpseInfo;
   }
@@ -338,6 +354,10 @@ class Potion : public Item {
     heat = max(0., heat - 0.005);
   }
 
+  virtual bool needsSpecialTick() const override {
+    return heat > 0;
+  }
+
   template <class Archive> 
   void serialize(Archive& ar, const unsigned int version) {
     ar& SUBCLASS(Item) 
@@ -24,15 +24,20 @@
 #include "collective_builder.h"
 #include "trigger.h"
 #include "progress_meter.h"
+#include "profiler.h"
+#include "shortest_path.h"
 
 template <class Archive> 
 void Level::serialize(Archive& ar, const unsigned int version) {
   ar& SUBCLASS(UniqueEntity)
     & SVAR(squares)
     & SVAR(landingSquares)
-    & SVAR(locations)
-    & SVAR(tickingSquares)
-    & SVAR(creatures)
+    & SVAR(locations);
+  if (version < 2) { // OBSOLETE
+    set<Vec2> tickingSquares; // SERIAL(tickingSquares)
+    ar & SVAR(tickingSquares);
+  }
+  ar & SVAR(creatures)
     & SVAR(model)
     & SVAR(fieldOfView)
     & SVAR(entryMessage)
@@ -49,6 +54,16 @@ void Level::serialize(Archive& ar, const unsigned int version) {
     ar & SVAR(lightCapAmount);
   else
     lightCapAmount = Table<double>(squares.getBounds(), 1);
+  if (version >= 3)
+    ar & SVAR(simulationTier)
+       & SVAR(lastTick);
+  if (Archive::is_loading::value) {
+    // The scheduler isn't saved, all squares get ticked once and the idle ones go back to sleep.
+    isAwake = Table<bool>(squares.getBounds(), false);
+    for (Vec2 pos : squares.getBounds())
+      addTickingSquare(pos);
+    initTransparency();
+  }
 }  
 
 SERIALIZABLE(Level);
@@ -61,7 +76,8 @@ Level::Level(Table<PSquare> s, Model* m, vector<Location*> l, const string& mess
     Table<CoverInfo> covers) 
     : squares(std::move(s)), locations(l), model(m), entryMessage(message), name(n), coverInfo(std::move(covers)),
       bucketMap(squares.getBounds().getW(), squares.getBounds().getH(), FieldOfView::sightRange),
-      lightAmount(squares.getBounds(), 0), lightCapAmount(squares.getBounds(), 1) {
+      lightAmount(squares.getBounds(), 0), lightCapAmount(squares.getBounds(), 1),
+      isAwake(squares.getBounds(), false) {
   for (Vec2 pos : squares.getBounds()) {
     squares[pos]->setLevel(this);
     optional<pair<StairDirection, StairKey>> link = squares[pos]->getLandingLink();
@@ -70,8 +86,9 @@ Level::Level(Table<PSquare> s, Model* m, vector<Location*> l, const string& mess
   }
   for (Location *l : locations)
     l->setLevel(this);
+  initTransparency();
   for (VisionId vision : ENUM_ALL(VisionId))
-    fieldOfView[vision] = FieldOfView(squares, vision);
+    fieldOfView[vision] = FieldOfView(&transparency[vision], getBounds());
   for (Vec2 pos : squares.getBounds())
     addLightSource(pos, squares[pos]->getLightEmission(), 1);
   updateSunlightMovement();
@@ -106,6 +123,7 @@ void Level::putCreature(Vec2 position, Creature* c) {
   c->setLevel(this);
   c->setPosition(position);
   getSafeSquare(position)->putCreature(c);
+  updateMovementCosts(position);
   if (c->isDarknessSource())
     addDarknessSource(c->getPosition(), darknessRadius);
   notifyLocations(c);
@@ -183,6 +201,7 @@ void Level::updateVisibility(Vec2 changedSquare) {
       if (c->isDarknessSource())
         addDarknessSource(pos, darknessRadius, -1);
   }
+  updateTransparency(changedSquare);
   for (VisionId vision : ENUM_ALL(VisionId))
     fieldOfView[vision].squareChanged(changedSquare);
   for (Vec2 pos : getVisibleTilesNoDarkness(changedSquare, VisionId::NORMAL)) {
@@ -312,6 +331,7 @@ void Level::killCreature(Creature* creature) {
   bucketMap.removeElement(creature->getPosition(), creature);
   removeElement(creatures, creature);
   getSafeSquare(creature->getPosition())->removeCreature();
+  updateMovementCosts(creature->getPosition());
   model->removeCreature(creature);
   if (creature->isPlayer())
     updatePlayer();
@@ -341,6 +361,7 @@ void Level::changeLevel(StairDirection dir, StairKey key, Creature* c) {
   Vec2 fromPosition = c->getPosition();
   removeElement(creatures, c);
   getSafeSquare(c->getPosition())->removeCreature();
+  updateMovementCosts(c->getPosition());
   bucketMap.removeElement(c->getPosition(), c);
   Vec2 toPosition = model->changeLevel(dir, key, c);
   GlobalEvents.addChangeLevelEvent(c, this, fromPosition, c->getLevel(), toPosition);
@@ -350,6 +371,7 @@ void Level::changeLevel(Level* destination, Vec2 landing, Creature* c) {
   Vec2 fromPosition = c->getPosition();
   removeElement(creatures, c);
   getSafeSquare(c->getPosition())->removeCreature();
+  updateMovementCosts(c->getPosition());
   bucketMap.removeElement(c->getPosition(), c);
   model->changeLevel(destination, landing, c);
   GlobalEvents.addChangeLevelEvent(c, this, fromPosition, destination, landing);
@@ -384,6 +406,24 @@ FieldOfView& Level::getFieldOfView(VisionId vision) const {
   return fieldOfView[vision];
 }
 
+const TransparencyMap& Level::getTransparency(VisionId vision) const {
+  return transparency[vision];
+}
+
+void Level::initTransparency() {
+  for (VisionId vision : ENUM_ALL(VisionId)) {
+    transparency[vision] = TransparencyMap(getBounds());
+    fieldOfView[vision].setTransparency(&transparency[vision]);
+  }
+  for (Vec2 pos : getBounds())
+    updateTransparency(pos);
+}
+
+void Level::updateTransparency(Vec2 pos) {
+  for (VisionId vision : ENUM_ALL(VisionId))
+    transparency[vision].setTransparent(pos, squares[pos]->canSeeThru(vision));
+}
+
 bool Level::canSee(Vec2 from, Vec2 to, VisionId vision) const {
   return isWithinVision(from, to, vision) && getFieldOfView(vision).canSee(from, to);
 }
@@ -417,6 +457,8 @@ void Level::moveCreature(Creature* creature, Vec2 direction) {
   thisSquare->removeCreature();
   creature->setPosition(position + direction);
   nextSquare->putCreature(creature);
+  updateMovementCosts(position);
+  updateMovementCosts(position + direction);
   if (creature->isAffected(LastingEffect::DARKNESS_SOURCE)) {
     addDarknessSource(position + direction, darknessRadius);
     removeDarknessSource(position, darknessRadius);
@@ -437,6 +479,8 @@ void Level::swapCreatures(Creature* c1, Creature* c2) {
   c2->setPosition(position1);
   square1->putCreature(c2);
   square2->putCreature(c1);
+  updateMovementCosts(position1);
+  updateMovementCosts(position2);
   if (c1->isAffected(LastingEffect::DARKNESS_SOURCE)) {
     addDarknessSource(position2, darknessRadius);
     removeDarknessSource(position1, darknessRadius);
@@ -517,12 +561,80 @@ vector<Square*> Level::getSquares(const vector<Vec2>& pos) {
 }
 
 void Level::addTickingSquare(Vec2 pos) {
-  tickingSquares.insert(pos);
+  if (!isAwake[pos]) {
+    isAwake[pos] = true;
+    awakeSquares.push_back(pos);
+    ++numWokenUp;
+  }
 }
 
 void Level::tick(double time) {
-  for (Vec2 pos : tickingSquares)
-    squares[pos]->tick(time);
+  PROFILE_ZONE("Level::tick");
+  if (!isTickTurn(time))
+    return;
+  int numTurns = 1;
+  if (simulationTier == SimulationTier::COARSE)
+    numTurns = min<double>(coarseTickInterval, floor(time - lastTick));
+  lastTick = time;
+  for (int i = numTurns - 1; i >= 0; --i)
+    tickSquares(time - i);
+}
+
+void Level::tickSquares(double time) {
+  wakeUpTimers.advance(time, [this](Vec2 pos, double) { addTickingSquare(pos); });
+  // Squares woken up while ticking are appended to the list, but ticked only from the next turn.
+  int numAwake = awakeSquares.size();
+  for (int i : Range(numAwake))
+    squares[awakeSquares[i]]->tick(time);
+  numTicked += numAwake;
+  int kept = 0;
+  for (int i : All(awakeSquares)) {
+    Vec2 pos = awakeSquares[i];
+    if (i < numAwake) {
+      optional<double> next = squares[pos]->getNextTick(time);
+      if (!next || *next >= time + 1) {
+        isAwake[pos] = false;
+        if (next)
+          wakeUpTimers.add(pos, *next);
+        continue;
+      }
+    }
+    awakeSquares[kept++] = pos;
+  }
+  awakeSquares.resize(kept);
+}
+
+void Level::catchUp(double time) {
+  int numTurns = min<double>(maxCatchUpTurns, floor(time - lastTick) - 1);
+  for (int i = numTurns; i >= 1; --i) {
+    tickSquares(time - i);
+    // Creatures may die while ticking.
+    for (Creature* c : vector<Creature*>(creatures))
+      if (!c->isDead())
+        c->tick(time - i);
+  }
+  lastTick = max(lastTick, time - 1);
+}
+
+Level::TickingStats Level::getTickingStats() const {
+  return {int(awakeSquares.size()), wakeUpTimers.getSize(), numTicked, numWokenUp};
+}
+
+Level::SimulationTier Level::getSimulationTier() const {
+  return simulationTier;
+}
+
+void Level::setSimulationTier(SimulationTier tier) {
+  simulationTier = tier;
+}
+
+bool Level::isTickTurn(double time) const {
+  switch (simulationTier) {
+    case SimulationTier::FULL: return true;
+    case SimulationTier::COARSE: return time >= lastTick + coarseTickInterval;
+    case SimulationTier::FROZEN: return false;
+  }
+  return true;
 }
 
 Level::Builder::Builder(ProgressMeter& meter, int width, int height, const string& n, bool covered)
@@ -715,15 +827,167 @@ const string& Level::getName() const {
 }
 
 void Level::updateConnectivity(Vec2 pos) {
+  updateMovementCosts(pos);
   for (auto& elem : sectors)
     if (getSafeSquare(pos)->canNavigate(elem.first))
       elem.second.add(pos);
     else
       elem.second.remove(pos);
+  for (auto& elem : pathClusters)
+    elem.second.invalidate(pos);
+  for (int i = flowFields.size() - 1; i >= 0; --i)
+    if (flowFields[i].field->isReached(pos)) {
+      removeIndex(flowFields, i);
+      ++flowFieldStats.numInvalidated;
+    }
+  for (auto& elem : safetyMaps)
+    for (auto it = elem.second.begin(); it != elem.second.end();)
+      if (pos.inRectangle(it->second->getBounds()))
+        it = elem.second.erase(it);
+      else
+        ++it;
+}
+
+double Level::getStaticEntryCost(const MovementType& movement, Vec2 pos) const {
+  const Square* square = getSafeSquare(pos);
+  if (square->canEnterEmpty(movement))
+    return 1;
+  if (square->canNavigate(movement))
+    return 5;
+  return ShortestPath::infinity;
+}
+
+const int maxFlowFields = 16;
+
+FlowField& Level::getFlowField(const MovementType& movement1, vector<Vec2> targets) const {
+  MovementType movement = getSectorsMovement(movement1);
+  sort(targets.begin(), targets.end());
+  targets.erase(unique(targets.begin(), targets.end()), targets.end());
+  ++flowFieldCounter;
+  for (CachedFlowField& elem : flowFields)
+    if (elem.movement == movement && !elem.key.owner && elem.field->getTargets() == targets) {
+      ++flowFieldStats.numHits;
+      elem.lastUsed = flowFieldCounter;
+      return *elem.field;
+    }
+  ++flowFieldStats.numMisses;
+  return addFlowField(movement, std::move(targets), {nullptr, 0});
+}
+
+FlowField& Level::getFlowField(const MovementType& movement1, FlowFieldKey key,
+    const vector<Vec2>& targets) const {
+  CHECK(key.owner);
+  MovementType movement = getSectorsMovement(movement1);
+  ++flowFieldCounter;
+  for (int i : All(flowFields)) {
+    CachedFlowField& elem = flowFields[i];
+    if (elem.movement == movement && elem.key.owner == key.owner) {
+      if (elem.key.version == key.version) {
+        ++flowFieldStats.numHits;
+        elem.lastUsed = flowFieldCounter;
+        return *elem.field;
+      }
+      removeIndex(flowFields, i);
+      break;
+    }
+  }
+  ++flowFieldStats.numMisses;
+  return addFlowField(movement, targets, key);
+}
+
+FlowField& Level::addFlowField(const MovementType& movement, vector<Vec2> targets, FlowFieldKey key) const {
+  if (flowFields.size() >= maxFlowFields)
+    removeIndex(flowFields, std::min_element(flowFields.begin(), flowFields.end(),
+        [](const CachedFlowField& f1, const CachedFlowField& f2) { return f1.lastUsed < f2.lastUsed; })
+        - flowFields.begin());
+  flowFields.push_back({movement, unique_ptr<FlowField>(new FlowField(getBounds(), std::move(targets),
+      [this, movement](Vec2 v) { return getStaticEntryCost(movement, v); })), flowFieldCounter, key});
+  return *flowFields.back().field;
+}
+
+Level::FlowFieldStats Level::getFlowFieldStats() const {
+  return flowFieldStats;
+}
+
+const int maxSafetyMapsPerTurn = 16;
+
+const SafetyMap* Level::getSafetyMap(const MovementType& movement1, vector<Vec2> threats, double time) const {
+  MovementType movement = getSectorsMovement(movement1);
+  sort(threats.begin(), threats.end());
+  threats.erase(unique(threats.begin(), threats.end()), threats.end());
+  long long turn = floor(time);
+  if (turn != safetyMapsTurn) {
+    safetyMaps.clear();
+    numSafetyMaps = 0;
+    safetyMapsTurn = turn;
+  }
+  auto& maps = safetyMaps[movement];
+  auto it = maps.find(threats);
+  if (it != maps.end())
+    return it->second.get();
+  // Counts the maps built and not the cached ones, so that invalidated maps don't get rebuilt forever.
+  if (numSafetyMaps >= maxSafetyMapsPerTurn)
+    return nullptr;
+  ++numSafetyMaps;
+  SafetyMap* ret = new SafetyMap(getBounds(), threats,
+      [this, movement](Vec2 v) { return getStaticEntryCost(movement, v); });
+  maps[threats] = unique_ptr<SafetyMap>(ret);
+  return ret;
+}
+
+uint8_t Level::getMovementCost(const MovementType& movement, Vec2 pos) const {
+  const Square* square = getSafeSquare(pos);
+  if (square->canEnter(movement))
+    return 1;
+  if (square->canNavigate(movement))
+    return 5;
+  return blockedCost;
+}
+
+const Table<uint8_t>& Level::getMovementCosts(const MovementType& movement) const {
+  std::unique_lock<std::mutex> lock(movementCostsMutex);
+  auto costs = movementCosts.find(movement);
+  if (costs == movementCosts.end()) {
+    costs = movementCosts.emplace(movement, Table<uint8_t>(getBounds())).first;
+    for (Vec2 v : getBounds())
+      costs->second[v] = getMovementCost(movement, v);
+  }
+  return costs->second;
+}
+
+void Level::updateMovementCosts(Vec2 pos) {
+  for (auto& elem : movementCosts)
+    elem.second[pos] = getMovementCost(elem.first, pos);
+}
+
+MovementType Level::getSectorsMovement(const MovementType& movement) const {
+  return squareOwners.count(movement.getTribe()) ? movement : movement.getWithNoTribe();
+}
+
+PathClusters& Level::getPathClusters(const MovementType& movement1) const {
+  MovementType movement = getSectorsMovement(movement1);
+  auto clusters = pathClusters.find(movement);
+  if (clusters == pathClusters.end())
+    clusters = pathClusters.emplace(movement, PathClusters(getBounds(),
+        [this, movement](Vec2 v) { return getStaticEntryCost(movement, v); })).first;
+  return clusters->second;
+}
+
+optional<vector<Vec2>> Level::getPathWaypoints(const MovementType& movement, Vec2 from, Vec2 to) const {
+  std::unique_lock<std::mutex> lock(pathClustersMutex);
+  return getPathClusters(movement).findWaypoints(from, to);
+}
+
+bool Level::isUniformCost(const Creature* creature, Rectangle area) const {
+  for (const Creature* other : bucketMap.getElements(area))
+    if (other != creature && other->getPosition().inRectangle(area))
+      return false;
+  std::unique_lock<std::mutex> lock(pathClustersMutex);
+  return getPathClusters(creature->getMovementType()).isUniform(area);
 }
 
 bool Level::areConnected(Vec2 p1, Vec2 p2, const MovementType& movement1) const {
-  MovementType movement = squareOwners.count(movement1.getTribe()) ? movement1 : movement1.getWithNoTribe();
+  MovementType movement = getSectorsMovement(movement1);
   if (!sectors.count(movement)) {
     sectors[movement] = Sectors(getBounds());
     Sectors& newSectors = sectors.at(movement);
@@ -737,7 +1001,14 @@ bool Level::areConnected(Vec2 p1, Vec2 p2, const MovementType& movement1) const
 void Level::updateSunlightMovement() {
   for (Vec2 v : getBounds())
     squares[v]->updateSunlightMovement(isInSunlight(v));
+  // The grids are recomputed in place, as paths may keep references to them.
+  for (auto& elem : movementCosts)
+    for (Vec2 v : getBounds())
+      elem.second[v] = getMovementCost(elem.first, v);
   sectors.clear();
+  pathClusters.clear();
+  flowFields.clear();
+  safetyMaps.clear();
 }
 
 void Level::addSquareOwner(const Tribe* t) {
@@ -26,6 +26,10 @@
 #include "player_message.h"
 #include "movement_type.h"
 #include "sectors.h"
+#include "timer_wheel.h"
+#include "path_clusters.h"
+#include "flow_field.h"
+#include "safety_map.h"
 
 class Model;
 class Square;
@@ -134,12 +138,41 @@ class Level : public UniqueEntity<Level> {
 
   void replaceSquare(Vec2 pos, PSquare square);
 
-  /** The given square's method Square::tick() will be called every turn. */
+  /** Wakes up the square, so that its method Square::tick() will be called every turn until
+      Square::getNextTick() tells that it can sleep. */
   void addTickingSquare(Vec2 pos);
 
-  /** Ticks all squares that must be ticked. */
+  /** Ticks all squares that are awake, and puts the idle ones to sleep. On a COARSE level the squares
+      catch up on the skipped turns, so fire and gas spread as fast as on a fully simulated level.*/
   void tick(double time);
 
+  struct TickingStats {
+    int numAwake;
+    int numScheduled;
+    long long numTicked;
+    long long numWokenUp;
+  };
+
+  /** Counters of the square scheduler. The last two accumulate since the level was created or loaded.*/
+  TickingStats getTickingStats() const;
+
+  /** How closely the level is simulated. Only levels near the player are fully simulated,
+      COARSE levels are ticked every coarseTickInterval turns, FROZEN levels not at all.*/
+  enum class SimulationTier { FULL, COARSE, FROZEN };
+  static const int coarseTickInterval = 5;
+  SimulationTier getSimulationTier() const;
+  void setSimulationTier(SimulationTier);
+
+  /** Most turns that are simulated when a level stops being FROZEN.*/
+  static const int maxCatchUpTurns = 20;
+
+  /** Ticks the squares and creatures for the turns skipped since the last tick, up to maxCatchUpTurns,
+      but not the current turn, which is left to tick().*/
+  void catchUp(double time);
+
+  /** Returns true if the level and its creatures should be ticked in the given turn.*/
+  bool isTickTurn(double time) const;
+
   /** Moves the creature to a different level according to \paramname{direction}. */
   void changeLevel(StairDirection direction, StairKey key, Creature* c);
 
@@ -173,6 +206,9 @@ class Level : public UniqueEntity<Level> {
   vector<Vec2> getVisibleTiles(const Creature*) const;
   vector<Vec2> getVisibleTiles(Vec2 pos, VisionId) const;
 
+  /** Returns the squares that can be seen through with given vision, packed into bits.*/
+  const TransparencyMap& getTransparency(VisionId) const;
+
   /** Checks if the player can see a given square.*/
   bool playerCanSee(Vec2 pos) const;
 
@@ -221,6 +257,52 @@ class Level : public UniqueEntity<Level> {
   /** Returns if two squares are connected assuming given movement.*/
   bool areConnected(Vec2, Vec2, const MovementType&) const;
 
+  /** Returns waypoints of a path between distant squares, see PathClusters. The path ignores creatures.
+      Can be called from several threads at once.*/
+  optional<vector<Vec2>> getPathWaypoints(const MovementType&, Vec2 from, Vec2 to) const;
+
+  /** Cost of entering a blocked square in the grids returned by getMovementCosts().*/
+  static const uint8_t blockedCost = 255;
+
+  /** Returns the cost of entering every square for the movement type, as used when searching
+      paths: 1 if it can be entered, 5 if it can be navigated, eg. by waiting for the creature
+      inside to move away or destroying a door, and blockedCost otherwise. The grid is kept up
+      to date as squares change and creatures move, and stays valid as long as the level.
+      Can be called from several threads at once.*/
+  const Table<uint8_t>& getMovementCosts(const MovementType&) const;
+
+  /** Returns the cost of entering the square as it is now, see getMovementCosts().*/
+  uint8_t getMovementCost(const MovementType&, Vec2) const;
+
+  /** Cost of entering the square used by the shared path structures, which ignore creatures.*/
+  double getStaticEntryCost(const MovementType&, Vec2) const;
+
+  /** Checks if the creature can enter all passable squares in the area at the same cost, ie. there are
+      no other creatures or obstacles that can be destroyed.*/
+  bool isUniformCost(const Creature*, Rectangle area) const;
+
+  /** Returns a flow field towards the closest of the targets, shared by everyone who asks for the same
+      targets and movement type. The field ignores creatures. It's dropped when a square that it has
+      already used changes, or when it's the least recently used of too many fields.*/
+  FlowField& getFlowField(const MovementType&, vector<Vec2> targets) const;
+
+  /** Same as above, but the field is looked up by the key, and replaces the one built for an older
+      version of the key.*/
+  FlowField& getFlowField(const MovementType&, FlowFieldKey, const vector<Vec2>& targets) const;
+
+  struct FlowFieldStats {
+    long long numHits;
+    long long numMisses;
+    long long numInvalidated;
+  };
+
+  FlowFieldStats getFlowFieldStats() const;
+
+  /** Returns a safety map for fleeing from a group of threats, shared by everyone who asks for the same
+      threats and movement type during the turn. The map ignores creatures. Returns nullptr if the turn
+      has already used up its maps.*/
+  const SafetyMap* getSafetyMap(const MovementType&, vector<Vec2> threats, double time) const;
+
   void updateConnectivity(Vec2);
   void updateSunlightMovement();
 
@@ -323,10 +405,10 @@ class Level : public UniqueEntity<Level> {
   Table<PSquare> SERIAL(squares);
   map<pair<StairDirection, StairKey>, vector<Vec2>> SERIAL(landingSquares);
   vector<Location*> SERIAL(locations);
-  set<Vec2> SERIAL(tickingSquares);
   vector<Creature*> SERIAL(creatures);
   Model* SERIAL(model) = nullptr;
   mutable EnumMap<VisionId, FieldOfView> SERIAL(fieldOfView);
+  EnumMap<VisionId, TransparencyMap> transparency;
   string SERIAL(entryMessage);
   string SERIAL(name);
   Creature* SERIAL(player) = nullptr;
@@ -337,7 +419,31 @@ class Level : public UniqueEntity<Level> {
   Table<double> SERIAL(lightAmount);
   Table<double> SERIAL(lightCapAmount);
   mutable unordered_map<MovementType, Sectors> SERIAL(sectors);
+  mutable unordered_map<MovementType, PathClusters> pathClusters;
+  mutable std::mutex pathClustersMutex;
+  mutable unordered_map<MovementType, Table<uint8_t>> movementCosts;
+  mutable std::mutex movementCostsMutex;
+  struct CachedFlowField {
+    MovementType movement;
+    unique_ptr<FlowField> field;
+    long long lastUsed;
+    FlowFieldKey key;
+  };
+  FlowField& addFlowField(const MovementType&, vector<Vec2> targets, FlowFieldKey) const;
+  mutable vector<CachedFlowField> flowFields;
+  mutable long long flowFieldCounter = 0;
+  mutable FlowFieldStats flowFieldStats {0, 0, 0};
+  mutable unordered_map<MovementType, map<vector<Vec2>, unique_ptr<SafetyMap>>> safetyMaps;
+  mutable int numSafetyMaps = 0;
+  mutable long long safetyMapsTurn = 0;
   unordered_set<const Tribe*> SERIAL(squareOwners);
+  SimulationTier SERIAL(simulationTier) = SimulationTier::FULL;
+  double SERIAL(lastTick) = -1000;
+  vector<Vec2> awakeSquares;
+  Table<bool> isAwake;
+  TimerWheel<Vec2> wakeUpTimers;
+  long long numTicked = 0;
+  long long numWokenUp = 0;
   
   Level(Table<PSquare> s, Model*, vector<Location*>, const string& message, const string& name,
       Table<CoverInfo> coverInfo);
@@ -345,6 +451,12 @@ class Level : public UniqueEntity<Level> {
   void addLightSource(Vec2 pos, double radius, int numLight);
   void addDarknessSource(Vec2 pos, double radius, int numLight);
   FieldOfView& getFieldOfView(VisionId vision) const;
+  void initTransparency();
+  void tickSquares(double time);
+  void updateTransparency(Vec2);
+  MovementType getSectorsMovement(const MovementType&) const;
+  PathClusters& getPathClusters(const MovementType&) const;
+  void updateMovementCosts(Vec2);
   vector<Vec2> getVisibleTilesNoDarkness(Vec2 pos, VisionId vision) const;
   bool isWithinVision(Vec2 from, Vec2 to, VisionId) const;
 
@@ -352,6 +464,6 @@ class Level : public UniqueEntity<Level> {
   void notifyLocations(Creature*);
 };
 
-BOOST_CLASS_VERSION(Level, 1)
+BOOST_CLASS_VERSION(Level, 3)
 
 #endif
@@ -41,6 +41,13 @@
 #include "clock.h"
 #include "skill.h"
 #include "parse_game.h"
+#include "null_view.h"
+#include "model_builder.h"
+#include "name_generator.h"
+#include "progress_meter.h"
+#include "profiler.h"
+#include "field_of_view.h"
+#include "level.h"
 
 #ifndef DATA_DIR
 #define DATA_DIR "."
@@ -108,6 +115,62 @@ vector<pair<MusicType, string>> getMusicTracks(const string& path) {
       {MusicType::NIGHT, path + "/night3.ogg"},
     };
 }
+static void benchmarkSimulation(int numTurns, Options* options, const string& freeDataPath) {
+  NullView view;
+  ProgressMeter meter(1);
+  NameGenerator::init(freeDataPath + "/names");
+  PModel model = ModelBuilder::collectiveModel(meter, options, &view,
+      NameGenerator::get(NameGeneratorId::WORLD)->getNext());
+  model->setOptions(options);
+  model->startBenchmark();
+  const int reportFreq = 1000;
+  double startTime = model->getTime();
+  long long start = Profiler::getMicros();
+  long long lastReport = start;
+  long long lastMoves = 0;
+  int turns = 0;
+  while (turns < numTurns) {
+    ++turns;
+    if (model->update(startTime + turns)) {
+      std::cout << "Game ended after " << turns << " turns" << endl;
+      break;
+    }
+    if (turns % reportFreq == 0) {
+      long long now = Profiler::getMicros();
+      std::cout << "Turns " << turns - reportFreq << "-" << turns << ": " << (now - lastReport) / 1000
+          << " ms, " << model->getNumMoves() - lastMoves << " moves" << endl;
+      lastReport = now;
+      lastMoves = model->getNumMoves();
+    }
+  }
+  double seconds = max<long long>(1, Profiler::getMicros() - start) / 1000000.0;
+  std::cout << turns << " turns, " << model->getNumMoves() << " moves in " << seconds << " s" << endl;
+  std::cout << turns / seconds << " turns/s, " << model->getNumMoves() / seconds << " moves/s, "
+      << 1000 * seconds * 1000 / turns << " ms per 1000 turns" << endl;
+  const FieldOfView::CacheStats& fov = FieldOfView::getCacheStats();
+  std::cout << "Field of view cache: " << fov.numHits << " hits, " << fov.numMisses << " misses, "
+      << fov.numEvicted << " evicted, " << fov.residentBytes / 1024 << " KB resident" << endl;
+  Level::FlowFieldStats flow {0, 0, 0};
+  for (const Level* level : model->getLevels()) {
+    Level::FlowFieldStats stats = level->getFlowFieldStats();
+    flow.numHits += stats.numHits;
+    flow.numMisses += stats.numMisses;
+    flow.numInvalidated += stats.numInvalidated;
+  }
+  std::cout << "Flow field cache: " << flow.numHits << " hits, " << flow.numMisses << " misses, "
+      << flow.numInvalidated << " invalidated" << endl;
+}
+
+static void benchmarkLevels(function<void(const Level*)> fun, Options* options, const string& freeDataPath) {
+  NullView view;
+  ProgressMeter meter(1);
+  NameGenerator::init(freeDataPath + "/names");
+  PModel model = ModelBuilder::collectiveModel(meter, options, &view,
+      NameGenerator::get(NameGeneratorId::WORLD)->getNext());
+  for (const Level* level : model->getLevels())
+    fun(level);
+}
+
 void makeDir(const string& path) {
   boost::filesystem::create_directories(path.c_str());
 }
@@ -122,9 +185,15 @@ int main(int argc, char* argv[]) {
     ("upload_url", value<string>(), "URL for uploading maps")
     ("override_settings", value<string>(), "Override settings")
     ("run_tests", "Run all unit tests and exit")
+    ("run_benchmarks", "Run all benchmarks and exit")
     ("gen_world_exit", "Exit after creating a world")
     ("force_keeper", "Skip main menu and force keeper mode")
     ("seed", value<int>(), "Use given seed")
+    ("bench_turns", value<int>(), "Simulate given number of turns of a keeper game without a window or input and exit")
+    ("bench_paths", value<int>(), "Run given number of random path searches on every level of a keeper game and exit")
+    ("bench_fov", value<int>(), "Compute field of view from given number of random squares on every level of a keeper game and exit")
+    ("profile_turns", value<int>(), "Write profiling statistics to the user dir every given number of turns")
+    ("fov_cache_mb", value<int>(), "Memory budget of the field of view cache in megabytes")
     ("replay", value<string>(), "Replay game from file");
   variables_map vars;
   store(parse_command_line(argc, argv, flags), vars);
@@ -132,10 +201,8 @@ int main(int argc, char* argv[]) {
     std::cout << flags << endl;
     return 0;
   }
-  if (vars.count("run_tests")) {
-    testAll();
-    return 0;
-  }
+  if (vars.count("fov_cache_mb"))
+    FieldOfView::setCacheBudget(size_t(vars["fov_cache_mb"].as<int>()) * 1024 * 1024);
   unique_ptr<View> view;
   unique_ptr<CompressedInput> input;
   unique_ptr<CompressedOutput> output;
@@ -146,6 +213,14 @@ int main(int argc, char* argv[]) {
   Spell::init();
   Epithet::init();
   Vision::init();
+  if (vars.count("run_tests")) {
+    testAll();
+    return 0;
+  }
+  if (vars.count("run_benchmarks")) {
+    benchmarkAll();
+    return 0;
+  }
   string dataPath;
   if (vars.count("data_dir"))
     dataPath = vars["data_dir"].as<string>();
@@ -175,6 +250,38 @@ int main(int argc, char* argv[]) {
   if (vars.count("override_settings"))
     overrideSettings = vars["override_settings"].as<string>();
   Options options(userPath + "/options.txt", overrideSettings);
+  if (vars.count("profile_turns"))
+    Profiler::setOutput(userPath + "/profile.csv", vars["profile_turns"].as<int>());
+  int seed = vars.count("seed") ? vars["seed"].as<int>() : int(time(0));
+  if (vars.count("bench_turns")) {
+    Random.init(seed);
+    std::cout << "Seed " << seed << endl;
+    benchmarkSimulation(vars["bench_turns"].as<int>(), &options, freeDataPath);
+    return 0;
+  }
+  if (vars.count("bench_paths") && vars["bench_paths"].as<int>() <= 0) {
+    std::cout << "bench_paths needs a positive number of searches" << endl;
+    return 1;
+  }
+  if (vars.count("bench_fov") && vars["bench_fov"].as<int>() <= 0) {
+    std::cout << "bench_fov needs a positive number of squares" << endl;
+    return 1;
+  }
+  if (vars.count("bench_paths") || vars.count("bench_fov")) {
+    // The levels only depend on the seed, so results of different runs can be compared.
+    int levelSeed = vars.count("seed") ? seed : 0;
+    Random.init(levelSeed);
+    std::cout << "Seed " << levelSeed << endl;
+    int numPaths = vars.count("bench_paths") ? vars["bench_paths"].as<int>() : 0;
+    int numFov = vars.count("bench_fov") ? vars["bench_fov"].as<int>() : 0;
+    benchmarkLevels([=] (const Level* level) {
+          if (numPaths > 0)
+            benchmarkLevelPaths(level, numPaths);
+          if (numFov > 0)
+            benchmarkLevelVisibility(level, numFov);
+        }, &options, freeDataPath);
+    return 0;
+  }
   Renderer renderer("KeeperRL", Vec2(36, 36), contribDataPath);
   Clock clock;
   GuiFactory guiFactory(&clock);
@@ -183,7 +290,6 @@ int main(int argc, char* argv[]) {
     guiFactory.loadNonFreeImages(paidDataPath + "/images");
   if (tilesPresent)
     initializeRendererTiles(renderer, paidDataPath + "/images");
-  int seed = vars.count("seed") ? vars["seed"].as<int>() : int(time(0));
  // int forceMode = vars.count("force_keeper") ? 0 : -1;
   bool genExit = vars.count("gen_world_exit");
   if (vars.count("replay")) {
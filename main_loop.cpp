@@ -13,6 +13,7 @@
 #include "clock.h"
 #include "model_builder.h"
 #include "parse_game.h"
+#include "profiler.h"
 
 MainLoop::MainLoop(View* v, Highscores* h, FileSharing* fSharing, const string& freePath,
     const string& uPath, Options* o, Jukebox* j, std::atomic<bool>& fin)
@@ -94,6 +95,7 @@ string stripNonAscii(string s) {
 }
 
 static void saveGame(PModel& model, const string& path) {
+  PROFILE_ZONE("saveGame");
   try {
     CompressedOutput out(path);
     Serialization::registerTypes(out.getArchive(), saveVersion);
@@ -136,7 +138,7 @@ void MainLoop::saveUI(PModel& model, Model::GameType type, View::SplashType spla
   Square::progressMeter = &meter;
   view->displaySplash(meter, splashType);
   string path = getSavePath(model.get(), type);
-  MEASURE(saveGame(model, path), "saving time");
+  saveGame(model, path);
   view->clearSplash();
   Square::progressMeter = nullptr;
   if (type == Model::GameType::RETIRED_KEEPER && options->getBoolValue(OptionId::ONLINE))
@@ -696,31 +696,66 @@ void MapGui::updateEnemyPositions(const vector<Vec2>& positions) {
     enemyPositions.setValue(v, true);
 }
 
-void MapGui::updateObjects(const CreatureView* view, MapLayout* mapLayout, bool smoothMovement, bool ui, bool moral) {
+const optional<ViewIndex>& MapGui::Snapshot::getObject(Vec2 pos) const {
+  Vec2 v = pos - area.getTopLeft();
+  return objects[v.y * area.getW() + v.x];
+}
+
+void MapGui::captureSnapshot(const CreatureView* view, optional<Rectangle> screenArea, Snapshot& snapshot) {
   const Level* level = view->getLevel();
-  levelBounds = view->getLevel()->getBounds();
-  updateEnemyPositions(view->getVisibleEnemies());
+  snapshot.levelBounds = level->getBounds();
+  snapshot.enemies = view->getVisibleEnemies();
+  snapshot.position = view->getPosition(false);
+  snapshot.defaultPosition = view->getPosition(true);
+  snapshot.time = view->getTime();
+  snapshot.movement = view->getMovementInfo();
+  Rectangle area = Rectangle(-30, -20, 30, 20).translate(*snapshot.defaultPosition);
+  if (screenArea && screenArea->intersects(level->getBounds())) {
+    area = *screenArea;
+    if (snapshot.position)
+      area = area.translate(*snapshot.position - area.middle());
+  }
+  snapshot.center = area.middle();
+  // A margin for the screen moving before the next snapshot arrives.
+  area = area.minusMargin(-2).intersection(level->getBounds());
+  snapshot.area = area;
+  snapshot.objects.resize(area.getW() * area.getH());
+  for (Vec2 pos : area) {
+    Vec2 v = pos - area.getTopLeft();
+    optional<ViewIndex>& index = snapshot.objects[v.y * area.getW() + v.x];
+    index.emplace();
+    view->getViewIndex(pos, *index);
+    if (!index->isEmpty())
+      index->setHighlight(HighlightType::NIGHT, 1.0 - level->getLight(pos));
+  }
+}
+
+Rectangle MapGui::getVisibleTiles() {
+  return layout->getAllTiles(getBounds(), levelBounds, getScreenPos());
+}
+
+void MapGui::updateObjects(const Snapshot& snapshot, MapLayout* mapLayout, bool smoothMovement, bool ui,
+    bool moral) {
+  levelBounds = snapshot.levelBounds;
+  updateEnemyPositions(snapshot.enemies);
   mouseUI = ui;
   showMorale = moral;
   layout = mapLayout;
-  for (Vec2 pos : mapLayout->getAllTiles(getBounds(), Level::getMaxBounds(), getScreenPos()))
-    objects[pos] = none;
+  if (objectsArea)
+    for (Vec2 pos : *objectsArea)
+      objects[pos] = none;
   if (!isCentered())
-    setCenter(*view->getPosition(true));
-  else if (auto pos = view->getPosition(false))
-    setCenter(*pos);
+    setCenter(*snapshot.defaultPosition);
+  else if (snapshot.position)
+    setCenter(*snapshot.position);
   // If we have a fixed position (control mode), disable key scrolling because they move the character
-  keyScrolling = !view->getPosition(false);
-  for (Vec2 pos : mapLayout->getAllTiles(getBounds(), Level::getMaxBounds(), getScreenPos())) 
-    if (level->inBounds(pos)) {
-      objects[pos].emplace();
-      view->getViewIndex(pos, *objects[pos]);
-      if (!objects[pos]->isEmpty())
-        objects[pos]->setHighlight(HighlightType::NIGHT, 1.0 - view->getLevel()->getLight(pos));
-    }
-  currentTimeGame = smoothMovement ? view->getTime() : 1000000000;
+  keyScrolling = !snapshot.position;
+  for (Vec2 pos : snapshot.area)
+    objects[pos] = snapshot.getObject(pos);
+  objectsArea = snapshot.area;
+  currentTimeGame = smoothMovement ? snapshot.time : 1000000000;
   if (smoothMovement) {
-    if (auto movement = view->getMovementInfo()) {
+    if (auto& movement = snapshot.movement) {
       if (!screenMovement || screenMovement->startTimeGame != movement->prevTime) {
         screenMovement = {
           movement->from,
@@ -21,6 +21,7 @@
 #include "view_id.h"
 #include "unique_entity.h"
 #include "view_index.h"
+#include "creature_view.h"
 
 class ViewIndex;
 class MapMemory;
@@ -48,7 +49,27 @@ class MapGui : public GuiElem {
   virtual void onMouseRelease() override;
   virtual void onKeyPressed2(Event::KeyEvent) override;
 
-  void updateObjects(const CreatureView*, MapLayout*, bool smoothMovement, bool mouseUI, bool showMorale);
+  /** Everything that the map needs from the game. Captured on the game thread and applied on the
+      render thread, so the game never has to touch the GUI.*/
+  struct Snapshot {
+    Rectangle levelBounds = Rectangle(1, 1);
+    Rectangle area = Rectangle(1, 1);
+    Vec2 center;
+    vector<optional<ViewIndex>> objects;
+    vector<Vec2> enemies;
+    optional<Vec2> position;
+    optional<Vec2> defaultPosition;
+    double time;
+    optional<CreatureView::MovementInfo> movement;
+
+    const optional<ViewIndex>& getObject(Vec2 pos) const;
+  };
+
+  /** Fills the snapshot with the tiles in screenArea, which should be the result of a recent
+      getVisibleTiles(). If the view has a fixed position, the area is moved to follow it.*/
+  static void captureSnapshot(const CreatureView*, optional<Rectangle> screenArea, Snapshot&);
+  void updateObjects(const Snapshot&, MapLayout*, bool smoothMovement, bool mouseUI, bool showMorale);
+  Rectangle getVisibleTiles();
   void setSpriteMode(bool);
   optional<Vec2> getHighlightedTile(Renderer& renderer);
   void setHint(const vector<string>&);
@@ -82,6 +103,7 @@ class MapGui : public GuiElem {
   Vec2 projectOnScreen(Vec2 wpos, int currentTimeReal);
   MapLayout* layout;
   Table<optional<ViewIndex>> objects;
+  optional<Rectangle> objectsArea;
   bool spriteMode;
   Rectangle levelBounds = Rectangle(1, 1);
   Callbacks callbacks;
@@ -78,29 +78,66 @@ bool MinimapGui::onLeftClick(Vec2 v) {
   return false;
 }
 
-void MinimapGui::update(const Level* level, Rectangle bounds, const CreatureView* creature, bool printLocations) {
-  info.bounds = bounds;
-  info.enemies.clear();
-  info.locations.clear();
+static int getPixelIndex(Vec2 v) {
+  Rectangle bounds = Level::getMaxBounds();
+  return (v.y - bounds.getPY()) * bounds.getW() + v.x - bounds.getPX();
+}
+
+void MinimapGui::captureSnapshot(const Level* level, Rectangle bounds, const CreatureView* creature,
+    Snapshot& snapshot, bool printLocations) {
   const MapMemory& memory = creature->getMemory();
   if (refreshBuffer) {
+    pixels.resize(Level::getMaxBounds().getW() * Level::getMaxBounds().getH());
+    roads.clear();
     for (Vec2 v : Level::getMaxBounds()) {
       if (!v.inRectangle(level->getBounds()) || !memory.hasViewIndex(v))
-        mapBuffer.setPixel(v.x, v.y, colors[ColorId::BLACK]);
+        pixels[getPixelIndex(v)] = colors[ColorId::BLACK];
       else {
-        mapBuffer.setPixel(v.x, v.y, Tile::getColor(level->getSafeSquare(v)->getViewObject()));
+        pixels[getPixelIndex(v)] = Tile::getColor(level->getSafeSquare(v)->getViewObject());
         if (level->getSafeSquare(v)->getViewObject().hasModifier(ViewObject::Modifier::ROAD))
-          info.roads.insert(v);
+          roads.insert(v);
       }
     }
     refreshBuffer = false;
+    fullVersion = ++version;
+    changes.clear();
   }
+  if (!memory.getUpdated().empty())
+    ++version;
   for (Vec2 v : memory.getUpdated()) {
-    mapBuffer.setPixel(v.x, v.y, Tile::getColor(level->getSafeSquare(v)->getViewObject()));
-    if (level->getSafeSquare(v)->getViewObject().hasModifier(ViewObject::Modifier::ROAD))
-      info.roads.insert(v);
+    PixelChange change {v, Tile::getColor(level->getSafeSquare(v)->getViewObject()),
+        level->getSafeSquare(v)->getViewObject().hasModifier(ViewObject::Modifier::ROAD)};
+    pixels[getPixelIndex(v)] = change.color;
+    if (change.road)
+      roads.insert(v);
+    changes.push_back({version, change});
   }
   memory.clearUpdated();
+  int applied = bufferVersion;
+  int numApplied = 0;
+  while (numApplied < changes.size() && changes[numApplied].first <= applied)
+    ++numApplied;
+  changes.erase(changes.begin(), changes.begin() + numApplied);
+  // If the renderer falls far behind, sending the whole map is cheaper.
+  if (changes.size() > pixels.size()) {
+    fullVersion = version;
+    changes.clear();
+  }
+  if (snapshot.version != version) {
+    snapshot.pixels.clear();
+    snapshot.changes.clear();
+    if (applied < fullVersion) {
+      snapshot.pixels = pixels;
+      snapshot.info.roads = roads;
+    } else
+      for (auto& elem : changes)
+        snapshot.changes.push_back(elem.second);
+    snapshot.version = version;
+  }
+  MinimapInfo& info = snapshot.info;
+  info.bounds = bounds;
+  info.enemies.clear();
+  info.locations.clear();
   info.player = *creature->getPosition(true);
   for (Vec2 pos : creature->getVisibleEnemies())
     if (pos.inRectangle(bounds))
@@ -124,6 +161,27 @@ void MinimapGui::update(const Level* level, Rectangle bounds, const CreatureView
     }
 }
 
+void MinimapGui::update(const Snapshot& snapshot) {
+  // Versions only grow, so an older snapshot would undo changes that were already applied.
+  if (snapshot.version > bufferVersion) {
+    if (!snapshot.pixels.empty()) {
+      for (Vec2 v : Level::getMaxBounds())
+        mapBuffer.setPixel(v.x, v.y, snapshot.pixels[getPixelIndex(v)]);
+      info.roads = snapshot.info.roads;
+    }
+    for (const PixelChange& change : snapshot.changes) {
+      mapBuffer.setPixel(change.pos.x, change.pos.y, change.color);
+      if (change.road)
+        info.roads.insert(change.pos);
+    }
+    bufferVersion = snapshot.version;
+  }
+  info.bounds = snapshot.info.bounds;
+  info.enemies = snapshot.info.enemies;
+  info.player = snapshot.info.player;
+  info.locations = snapshot.info.locations;
+}
+
 static Vec2 embed(Vec2 levelSize, Vec2 screenSize) {
   double s = min(double(screenSize.x) / levelSize.x, double(screenSize.y) / levelSize.y);
   return levelSize * s;
@@ -134,8 +192,10 @@ void MinimapGui::presentMap(const CreatureView* creature, Rectangle bounds, Rend
   const Level* level = creature->getLevel();
   double scale = min(double(bounds.getW()) / level->getBounds().getW(),
       double(bounds.getH()) / level->getBounds().getH());
+  Snapshot snapshot;
   while (1) {
-    update(level, level->getBounds(), creature, true);
+    captureSnapshot(level, level->getBounds(), creature, snapshot, true);
+    update(snapshot);
     renderMap(r, Rectangle(Vec2(0, 0), embed(level->getBounds().getBottomRight(), bounds.getBottomRight())));
     r.drawAndClearBuffer();
     Event event;
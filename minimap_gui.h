@@ -28,7 +28,41 @@ class MinimapGui : public GuiElem {
 
   MinimapGui(function<void()> clickFun);
 
-  void update(const Level* level, Rectangle bounds, const CreatureView* creature, bool printLocations = false);
+  struct MinimapInfo {
+    Rectangle bounds;
+    unordered_set<Vec2> roads;
+    vector<Vec2> enemies;
+    Vec2 player;
+    struct Location {
+      Vec2 pos;
+      string text;
+    };
+    vector<Location> locations;
+  };
+
+  struct PixelChange {
+    Vec2 pos;
+    Color color;
+    bool road;
+  };
+
+  /** Minimap state captured on the game thread. The whole map is only copied when the renderer doesn't
+      have it yet, otherwise the snapshot holds the squares changed since the version that the renderer
+      applied last.*/
+  struct Snapshot {
+    /** The whole map, or empty.*/
+    vector<Color> pixels;
+    vector<PixelChange> changes;
+    int version = -1;
+    /** The roads are only set together with the whole map.*/
+    MinimapInfo info;
+  };
+
+  /** Called on the game thread. Tracks changes to the creature's map memory.*/
+  void captureSnapshot(const Level* level, Rectangle bounds, const CreatureView* creature, Snapshot&,
+      bool printLocations = false);
+  /** Called on the render thread.*/
+  void update(const Snapshot&);
   void presentMap(const CreatureView*, Rectangle bounds, Renderer&, function<void(double, double)> clickFun);
   void clear();
 
@@ -40,22 +74,22 @@ class MinimapGui : public GuiElem {
   void renderMap(Renderer&, Rectangle target);
   void putMapPixel(Vec2 pos, Color col);
 
-  struct MinimapInfo {
-    Rectangle bounds;
-    unordered_set<Vec2> roads;
-    vector<Vec2> enemies;
-    Vec2 player;
-    struct Location {
-      Vec2 pos;
-      string text;
-    };
-    vector<Location> locations;
-  } info;
+  MinimapInfo info;
 
   function<void()> clickFun;
 
   sf::Texture mapBufferTex;
   sf::Image mapBuffer;
+  /** Written on the render thread, read on the game thread to know which changes are still needed.*/
+  atomic<int> bufferVersion {-1};
+
+  vector<Color> pixels;
+  unordered_set<Vec2> roads;
+  int version = 0;
+  /** Version in which the whole map was last captured.*/
+  int fullVersion = 0;
+  /** Changes with their versions, which the renderer may not have yet.*/
+  vector<pair<int, PixelChange>> changes;
   bool refreshBuffer = true;
 };
 
@@ -33,6 +33,7 @@
 #include "music.h"
 #include "trigger.h"
 #include "highscores.h"
+#include "profiler.h"
 
 
 template <class Archive> 
@@ -71,9 +72,15 @@ void Model::serialize(Archive& ar, const unsigned int version) {
   }
   if (version >= 2)
     ar & SVAR(finishCurrentMusic);
+  if (version >= 4)
+    ar & SVAR(thawedLevels);
   Deity::serializeAll(ar);
-  if (Archive::is_loading::value)
+  if (Archive::is_loading::value) {
     updateSunlightInfo();
+    updateCollectiveMembership();
+    for (Creature* c : timeQueue.getAllCreatures())
+      c->addEffectTimers(this);
+  }
 }
 
 
@@ -199,7 +206,11 @@ const Creature* Model::getPlayer() const {
   return nullptr;
 }
 
+// How far a creature on a frozen level is moved in the time queue when it comes up.
+const double frozenTurnSkip = 50;
+
 optional<Model::ExitInfo> Model::update(double totalTime) {
+  PROFILE_ZONE("Model::update");
   if (addHero) {
     CHECK(playerControl && playerControl->isRetired());
     landHeroPlayer();
@@ -214,49 +225,46 @@ optional<Model::ExitInfo> Model::update(double totalTime) {
     view->updateView(spectator.get(), false);
     lastUpdate = absoluteTime;
   } 
+  bool firstMove = true;
   do {
     Creature* creature = timeQueue.getNextCreature();
     CHECK(creature) << "No more creatures";
     //Debug() << creature->getName().the() << " moving now " << creature->getTime();
     currentTime = creature->getTime();
-    if (spectator)
-      while (1) {
-        UserInput input = view->getAction();
-        if (input.getId() == UserInputId::EXIT)
-          return ExitInfo::abandonGame();
-        if (input.getId() == UserInputId::IDLE)
-          break;
-      }
-    if (playerControl && !playerControl->isTurnBased()) {
-      while (1) {
-        UserInput input = view->getAction();
-        if (input.getId() == UserInputId::IDLE)
-          break;
-        else
-          lastUpdate = -10;
-        playerControl->processInput(view, input);
-        if (exitInfo)
-          return exitInfo;
-      }
+    if (!isTurnBased() && (firstMove || ++movesSinceInput >= inputBatchSize)) {
+      if (auto exit = processInput())
+        return exit;
+      updateInputBatchSize();
+      movesSinceInput = 0;
     }
+    firstMove = false;
     if (currentTime > totalTime)
       return none;
-    if (currentTime >= lastTick + 1) {
-      MEASURE({ tick(currentTime); }, "ticking time");
-    }
-    if (!creature->isDead()) {
+    if (currentTime >= lastTick + 1)
+      tick(currentTime);
+    bool frozen = creature->getLevel()->getSimulationTier() == Level::SimulationTier::FROZEN;
+    if (frozen)
+      creature->setTime(creature->getTime() + frozenTurnSkip);
+    else if (!creature->isDead()) {
+      double timeBefore = creature->getTime();
 #ifndef RELEASE
       CreatureAction::checkUsage(true);
 #endif
       creature->makeMove();
+      ++numMoves;
 #ifndef RELEASE
       CreatureAction::checkUsage(false);
 #endif
       if (exitInfo)
         return exitInfo;
+      // Creatures on coarse levels act proportionally less often. The move may have changed the level.
+      if (!creature->isDead() && creature->getLevel()->getSimulationTier() == Level::SimulationTier::COARSE)
+        creature->setTime(timeBefore + Level::coarseTickInterval * (creature->getTime() - timeBefore));
     }
-    for (PCollective& c : collectives)
-      c->update(creature);
+    // A frozen creature didn't do anything that its collectives could react to.
+    if (!frozen)
+      for (Collective* c : getCollectives(creature))
+        c->update(creature);
     if (!creature->isDead()) {
       Level* level = creature->getLevel();
       CHECK(level->getSafeSquare(creature->getPosition())->getCreature() == creature);
@@ -264,21 +272,155 @@ optional<Model::ExitInfo> Model::update(double totalTime) {
   } while (1);
 }
 
+void Model::updateSimulationTiers() {
+  if (levels.size() < 2)
+    return;
+  set<const Level*> active;
+  for (PLevel& l : levels)
+    if (l->getPlayer())
+      active.insert(l.get());
+  if (playerControl)
+    for (Creature* c : playerControl->getCreatures())
+      active.insert(c->getLevel());
+  if (spectator)
+    active.insert(spectator->getLevel());
+  set<const Level*> coarse;
+  for (auto& link : levelLinks)
+    if (active.count(std::get<2>(link.first)))
+      coarse.insert(link.second);
+  for (PLevel& l : levels)
+    if (active.empty() || active.count(l.get()))
+      setSimulationTier(l.get(), Level::SimulationTier::FULL);
+    else if (coarse.count(l.get()))
+      setSimulationTier(l.get(), Level::SimulationTier::COARSE);
+    else
+      setSimulationTier(l.get(), Level::SimulationTier::FROZEN);
+}
+
+void Model::setSimulationTier(Level* level, Level::SimulationTier tier) {
+  if (level->getSimulationTier() == tier)
+    return;
+  bool wasFrozen = level->getSimulationTier() == Level::SimulationTier::FROZEN;
+  level->setSimulationTier(tier);
+  if (wasFrozen) {
+    // Frozen creatures were pushed into the future. Bring them back within one turn, keeping their
+    // relative order, so that the catch-up doesn't depend on when exactly the level was unfrozen.
+    for (Creature* c : level->getAllCreatures())
+      if (c->getTime() > currentTime + 1) {
+        c->setTime(currentTime + fmod(c->getTime() - currentTime, 1.0));
+        timeQueue.updateTime(c);
+      }
+    // The level may be unfrozen in the middle of a move, so it catches up at the start of the next tick.
+    if (!contains(thawedLevels, level))
+      thawedLevels.push_back(level);
+  }
+}
+
+optional<Model::ExitInfo> Model::processInput() {
+  if (spectator)
+    while (1) {
+      UserInput input = view->getAction();
+      if (input.getId() == UserInputId::EXIT)
+        return ExitInfo::abandonGame();
+      if (input.getId() == UserInputId::IDLE)
+        break;
+    }
+  if (playerControl && !playerControl->isTurnBased()) {
+    while (1) {
+      UserInput input = view->getAction();
+      if (input.getId() == UserInputId::IDLE)
+        break;
+      else
+        lastUpdate = -10;
+      playerControl->processInput(view, input);
+      if (exitInfo)
+        return exitInfo;
+    }
+  }
+  return none;
+}
+
+const int inputPollMillis = 5;
+const int maxInputBatchSize = 256;
+
+void Model::updateInputBatchSize() {
+  // Uses the game clock and not the absolute time, so that replays make the same decisions.
+  int time = view->getTimeMilli();
+  if (time - lastInputTime < inputPollMillis)
+    inputBatchSize = min(maxInputBatchSize, 2 * inputBatchSize);
+  else if (time - lastInputTime > 2 * inputPollMillis)
+    inputBatchSize = max(1, inputBatchSize / 2);
+  lastInputTime = time;
+}
+
+const vector<Collective*>& Model::getCollectives(const Creature* c) const {
+  static const vector<Collective*> empty;
+  auto it = collectiveMembership.find(c);
+  if (it == collectiveMembership.end())
+    return empty;
+  return it->second;
+}
+
+void Model::addCollectiveMember(Collective* col, const Creature* c) {
+  vector<Collective*>& cols = collectiveMembership[c];
+  if (!contains(cols, col))
+    cols.push_back(col);
+}
+
+void Model::removeCollectiveMember(Collective* col, const Creature* c) {
+  auto it = collectiveMembership.find(c);
+  if (it != collectiveMembership.end()) {
+    removeElementMaybe(it->second, col);
+    if (it->second.empty())
+      collectiveMembership.erase(it);
+  }
+}
+
+void Model::updateCollectiveMembership() {
+  collectiveMembership.clear();
+  for (PCollective& col : collectives)
+    for (const Creature* c : col->getCreatures())
+      addCollectiveMember(col.get(), c);
+}
+
 const vector<Collective*> Model::getMainVillains() const {
   return mainVillains;
 }
 
 void Model::tick(double time) {
+  PROFILE_ZONE("Model::tick");
   updateSunlightInfo();
   Debug() << "Turn " << time;
-  for (Creature* c : timeQueue.getAllCreatures()) {
-    c->tick(time);
-  }
+  updateSimulationTiers();
+  for (Level* l : thawedLevels)
+    l->catchUp(time);
+  thawedLevels.clear();
+  effectTimers.advance(time, [&](pair<Creature*, LastingEffect> timer, double endTime) {
+      Creature* c = timer.first;
+      if (c->isDead())
+        return;
+      if (c->getLevel()->isTickTurn(time))
+        c->onEffectTimer(timer.second, endTime, time);
+      else
+        parkedEffectTimers[c->getLevel()].push_back({timer, endTime});
+  });
+  for (PLevel& l : levels)
+    if (l->isTickTurn(time) && parkedEffectTimers.count(l.get())) {
+      vector<pair<pair<Creature*, LastingEffect>, double>> timers;
+      timers.swap(parkedEffectTimers.at(l.get()));
+      parkedEffectTimers.erase(l.get());
+      for (auto& timer : timers)
+        if (!timer.first.first->isDead())
+          timer.first.first->onEffectTimer(timer.first.second, timer.second, time);
+    }
+  for (Creature* c : timeQueue.getAllCreatures())
+    if (c->getLevel()->isTickTurn(time))
+      c->tick(time);
   for (PLevel& l : levels)
     l->tick(time);
   lastTick = time;
   if (playerControl) {
-    if (!playerControl->isRetired()) {
+    if (!playerControl->isRetired() || benchmark) {
       for (PCollective& col : collectives)
         col->tick(time);
       bool conquered = true;
@@ -291,14 +433,21 @@ void Model::tick(double time) {
     } else // temp fix to the player gets the location message
       playerControl->tick(time);
   }
+  GlobalEvents.flushDeferred();
+  Profiler::onTurn(time);
   if (musicType == MusicType::PEACEFUL && sunlightInfo.state == SunlightInfo::NIGHT)
     setCurrentMusic(MusicType::NIGHT, true);
   else if (musicType == MusicType::NIGHT && sunlightInfo.state == SunlightInfo::DAY)
     setCurrentMusic(MusicType::PEACEFUL, true);
 }
 
+void Model::addEffectTimer(Creature* c, LastingEffect effect, double time) {
+  effectTimers.add({c, effect}, time);
+}
+
 void Model::addCreature(PCreature c) {
   c->setTime(timeQueue.getCurrentTime() + 1 + Random.getDouble());
+  c->addEffectTimers(this);
   timeQueue.addCreature(std::move(c));
 }
 
@@ -420,6 +569,12 @@ void Model::retireCollective() {
   addHero = true;
 }
 
+void Model::startBenchmark() {
+  CHECK(playerControl);
+  playerControl->retire();
+  benchmark = true;
+}
+
 void Model::landHeroPlayer() {
   auto handicap = view->getNumber("Choose handicap (your adventurer's strength and dexterity increase)", 0, 20, 5);
   PCreature player = makePlayer(handicap.get_value_or(0));
@@ -464,6 +619,10 @@ void Model::setHighscores(Highscores* h) {
   highscores = h;
 }
 
+long long Model::getNumMoves() const {
+  return numMoves;
+}
+
 void Model::addLink(StairDirection dir, StairKey key, Level* l1, Level* l2) {
   levelLinks[make_tuple(dir, key, l1)] = l2;
   levelLinks[make_tuple(opposite(dir), key, l2)] = l1;
@@ -477,6 +636,7 @@ Vec2 Model::changeLevel(StairDirection dir, StairKey key, Creature* c) {
     current->updatePlayer();
     target->updatePlayer();
   }
+  updateSimulationTiers();
   return newPos;
 }
 
@@ -487,6 +647,7 @@ void Model::changeLevel(Level* target, Vec2 position, Creature* c) {
     current->updatePlayer();
     target->updatePlayer();
   }
+  updateSimulationTiers();
 }
   
 void Model::conquered(const string& title, vector<const Creature*> kills, int points) {
@@ -503,8 +664,10 @@ void Model::conquered(const string& title, vector<const Creature*> kills, int po
         c.playerName = title;
         c.gameResult = "achieved world domination";
   );
-  highscores->add(score);
-  highscores->present(view, score);
+  if (highscores) {
+    highscores->add(score);
+    highscores->present(view, score);
+  }
 }
 
 void Model::killedKeeper(const string& title, const string& keeper, const string& land,
@@ -523,8 +686,10 @@ void Model::killedKeeper(const string& title, const string& keeper, const string
         c.playerName = title;
         c.gameResult = "freed his land from " + keeper;
   );
-  highscores->add(score);
-  highscores->present(view, score);
+  if (highscores) {
+    highscores->add(score);
+    highscores->present(view, score);
+  }
 }
 
 bool Model::isGameOver() const {
@@ -550,8 +715,10 @@ void Model::gameOver(const Creature* creature, int numKills, const string& enemi
         c.playerName = *creature->getFirstName();
         c.gameResult = (killer.empty() ? "" : "killed by " + killer);
   );
-  highscores->add(score);
-  highscores->present(view, score);
+  if (highscores) {
+    highscores->add(score);
+    highscores->present(view, score);
+  }
   exitInfo = ExitInfo::abandonGame();
 }
 
@@ -559,6 +726,10 @@ const string& Model::getWorldName() const {
   return worldName;
 }
 
+vector<Level*> Model::getLevels() const {
+  return extractRefs(levels);
+}
+
 Level* Model::prepareTopLevel(ProgressMeter& meter, vector<SettlementInfo> settlements) {
   Level* top = buildLevel(
       Level::Builder(meter, 250, 250, "Wilderness", false),
@@ -21,6 +21,7 @@
 #include "time_queue.h"
 #include "level_maker.h"
 #include "statistics.h"
+#include "timer_wheel.h"
 
 class PlayerControl;
 class Level;
@@ -70,6 +71,14 @@ class Model {
 
   const vector<Collective*> getMainVillains() const;
 
+  /** Returns the collectives that the creature is a member of. Maintained by the collectives.*/
+  const vector<Collective*>& getCollectives(const Creature*) const;
+  void addCollectiveMember(Collective*, const Creature*);
+  void removeCollectiveMember(Collective*, const Creature*);
+
+  /** The creature will be notified about the effect's end time in the first tick after it.*/
+  void addEffectTimer(Creature*, LastingEffect, double time);
+
   bool isTurnBased();
 
   string getGameIdentifier() const;
@@ -86,6 +95,9 @@ class Model {
   void setOptions(Options*);
   void setHighscores(Highscores*);
 
+  /** Number of creature moves made since the model was created or loaded.*/
+  long long getNumMoves() const;
+
   Statistics& getStatistics();
   const Statistics& getStatistics() const;
 
@@ -97,6 +109,9 @@ class Model {
   bool isGameOver() const;
   static void showCredits(View*);
   void retireCollective();
+  /** Takes away the keeper's input for a headless benchmark. Unlike in a retired game the collectives
+      keep ticking, so the keeper's minions and the villages play on their own.*/
+  void startBenchmark();
 
   struct SunlightInfo {
     double lightAmount;
@@ -108,6 +123,9 @@ class Model {
 
   const string& getWorldName() const;
 
+  /** All levels of the world, starting with the top level.*/
+  vector<Level*> getLevels() const;
+
   SERIALIZATION_DECL(Model);
 
   Encyclopedia keeperopedia;
@@ -138,6 +156,10 @@ class Model {
   friend class ModelBuilder;
 
   void updateSunlightInfo();
+  optional<ExitInfo> processInput();
+  void updateSimulationTiers();
+  void setSimulationTier(Level*, Level::SimulationTier);
+  void updateInputBatchSize();
   PCreature makePlayer(int handicap);
   const Creature* getPlayer() const;
   void landHeroPlayer();
@@ -150,6 +172,13 @@ class Model {
   vector<PCollective> SERIAL(collectives);
   Collective* SERIAL(playerCollective);
   vector<Collective*> SERIAL(mainVillains);
+  unordered_map<const Creature*, vector<Collective*>> collectiveMembership;
+  void updateCollectiveMembership();
+  TimerWheel<pair<Creature*, LastingEffect>> effectTimers;
+  /** Timers that ran out on a level that wasn't ticked in that turn, handled in the level's next tick.
+      They're restored from the creatures on load, like effectTimers.*/
+  unordered_map<const Level*, vector<pair<pair<Creature*, LastingEffect>, double>>> parkedEffectTimers;
+  vector<Level*> SERIAL(thawedLevels);
   View* view;
   TimeQueue SERIAL(timeQueue);
   vector<PCreature> SERIAL(deadCreatures);
@@ -162,8 +191,13 @@ class Model {
   double SERIAL(currentTime) = 0;
   SunlightInfo sunlightInfo;
   double lastUpdate = -10;
+  int inputBatchSize = 1;
+  int movesSinceInput = 0;
+  int lastInputTime = 0;
   Options* options;
-  Highscores* highscores;
+  Highscores* highscores = nullptr;
+  long long numMoves = 0;
+  bool benchmark = false;
   string SERIAL(worldName);
   MusicType SERIAL(musicType);
   bool SERIAL(finishCurrentMusic) = false;
@@ -176,6 +210,6 @@ class Model {
   string SERIAL(gameDisplayName);
 };
 
-BOOST_CLASS_VERSION(Model, 3)
+BOOST_CLASS_VERSION(Model, 4)
 
 #endif
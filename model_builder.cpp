@@ -513,3 +513,9 @@ PModel ModelBuilder::splashModel(ProgressMeter& meter, View* view, const string&
   return PModel(m);
 }
 
+PModel ModelBuilder::singleLevelModel(ProgressMeter& meter, View* view, int width, int height, LevelMaker* maker) {
+  Model* m = new Model(view, "", Tribe::Set());
+  m->buildLevel(Level::Builder(meter, width, height, "Test"), maker);
+  return PModel(m);
+}
+
@@ -14,6 +14,9 @@ class ModelBuilder {
 
   static PModel splashModel(ProgressMeter&, View*, const string& splashPath);
 
+  /** Generates a model with a single level made by the maker, used in tests.*/
+  static PModel singleLevelModel(ProgressMeter&, View*, int width, int height, LevelMaker*);
+
   private:
   static PModel tryCollectiveModel(ProgressMeter&, Options*, View*, const string& worldName);
 
@@ -302,6 +302,22 @@ class GoldLust : public Behaviour {
   }
 };
 
+const int maxAttackingGroup = 12;
+
+/** The attacker and the creature's enemies that stand close to it or to each other. Everyone who flees
+    from the same fight gets the same group, so they can share a safety map.*/
+static vector<Vec2> getAttackingGroup(const Creature* creature, const Creature* attacker) {
+  const Level* level = attacker->getLevel();
+  vector<Vec2> ret {attacker->getPosition()};
+  for (int i = 0; i < ret.size() && ret.size() < maxAttackingGroup; ++i)
+    for (Vec2 v : Rectangle(ret[i] - Vec2(2, 2), ret[i] + Vec2(3, 3)))
+      if (v.inRectangle(level->getBounds()) && !contains(ret, v))
+        if (const Creature* other = level->getSafeSquare(v)->getCreature())
+          if (creature->isEnemy(other) && ret.size() < maxAttackingGroup)
+            ret.push_back(v);
+  return ret;
+}
+
 class Fighter : public Behaviour {
   public:
   Fighter(Creature* c, double powerR, bool _chase) : Behaviour(c), maxPowerRatio(powerR), chase(_chase) {
@@ -374,7 +390,7 @@ class Fighter : public Behaviour {
     if (other->getPosition().dist8(creature->getPosition()) > 3)
       if (auto move = getFireMove(other->getPosition() - creature->getPosition()))
         return {weight, move.move};
-    if (auto action = creature->moveAway(other->getPosition(), chase))
+    if (auto action = creature->moveAway(other->getPosition(), getAttackingGroup(creature, other), chase))
       return {weight, action.prepend([=](Creature* creature) {
         creature->setInCombat();
         other->setInCombat();
@@ -768,7 +784,7 @@ class Thief : public Behaviour {
       if (creature->canSee(other)) {
         if (MoveInfo teleMove = tryEffect(EffectId::TELEPORT, 1))
           return teleMove;
-        if (auto action = creature->moveAway(other->getPosition()))
+        if (auto action = creature->moveAway(other->getPosition(), getAttackingGroup(creature, other)))
         return {1.0, action};
       }
     }
@@ -0,0 +1,114 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+#include "stdafx.h"
+
+#include "null_view.h"
+
+void NullView::initialize() {
+}
+
+void NullView::reset() {
+}
+
+void NullView::displaySplash(const ProgressMeter&, View::SplashType, function<void()> cancelFun) {
+}
+
+void NullView::clearSplash() {
+}
+
+void NullView::close() {
+}
+
+void NullView::refreshView() {
+}
+
+double NullView::getGameSpeed() {
+  return 1;
+}
+
+void NullView::updateView(const CreatureView*, bool noRefresh) {
+}
+
+void NullView::drawLevelMap(const CreatureView*) {
+}
+
+void NullView::resetCenter() {
+}
+
+UserInput NullView::getAction() {
+  return UserInput(UserInputId::IDLE);
+}
+
+bool NullView::travelInterrupt() {
+  return false;
+}
+
+optional<int> NullView::chooseFromList(const string& title, const vector<ListElem>& options, int index,
+    MenuType, double* scrollPos, optional<UserInputId> exitAction) {
+  return none;
+}
+
+View::GameTypeChoice NullView::chooseGameType() {
+  return View::BACK_CHOICE;
+}
+
+optional<Vec2> NullView::chooseDirection(const string& message) {
+  return none;
+}
+
+bool NullView::yesOrNoPrompt(const string& message, bool defaultNo) {
+  return false;
+}
+
+void NullView::presentText(const string& title, const string& text) {
+}
+
+void NullView::presentList(const string& title, const vector<ListElem>& options, bool scrollDown,
+    MenuType, optional<UserInputId> exitAction) {
+}
+
+optional<int> NullView::getNumber(const string& title, int min, int max, int increments) {
+  return none;
+}
+
+optional<string> NullView::getText(const string& title, const string& value, int maxLength,
+    const string& hint) {
+  return none;
+}
+
+void NullView::animateObject(vector<Vec2> trajectory, ViewObject object) {
+}
+
+void NullView::animation(Vec2 pos, AnimationId) {
+}
+
+// The clock never moves, so the model never tries to render.
+int NullView::getTimeMilli() {
+  return 0;
+}
+
+int NullView::getTimeMilliAbsolute() {
+  return 0;
+}
+
+void NullView::stopClock() {
+}
+
+void NullView::continueClock() {
+}
+
+bool NullView::isClockStopped() {
+  return false;
+}
@@ -0,0 +1,57 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+#ifndef _NULL_VIEW_H
+#define _NULL_VIEW_H
+
+#include "view.h"
+
+/** View that doesn't display anything and never produces any input. Used to run the game without
+    a window, for example to benchmark the simulation. See view.h for documentation.*/
+class NullView : public View {
+  public:
+  virtual void initialize() override;
+  virtual void reset() override;
+  virtual void displaySplash(const ProgressMeter&, View::SplashType, function<void()> cancelFun) override;
+  virtual void clearSplash() override;
+  virtual void close() override;
+  virtual void refreshView() override;
+  virtual double getGameSpeed() override;
+  virtual void updateView(const CreatureView*, bool noRefresh) override;
+  virtual void drawLevelMap(const CreatureView*) override;
+  virtual void resetCenter() override;
+  virtual UserInput getAction() override;
+  virtual bool travelInterrupt() override;
+  virtual optional<int> chooseFromList(const string& title, const vector<ListElem>& options, int index = 0,
+      MenuType = View::NORMAL_MENU, double* scrollPos = nullptr,
+      optional<UserInputId> exitAction = none) override;
+  virtual GameTypeChoice chooseGameType() override;
+  virtual optional<Vec2> chooseDirection(const string& message) override;
+  virtual bool yesOrNoPrompt(const string& message, bool defaultNo) override;
+  virtual void presentText(const string& title, const string& text) override;
+  virtual void presentList(const string& title, const vector<ListElem>& options, bool scrollDown = false,
+      MenuType = NORMAL_MENU, optional<UserInputId> exitAction = none) override;
+  virtual optional<int> getNumber(const string& title, int min, int max, int increments = 1) override;
+  virtual optional<string> getText(const string& title, const string& value, int maxLength,
+      const string& hint) override;
+  virtual void animateObject(vector<Vec2> trajectory, ViewObject object) override;
+  virtual void animation(Vec2 pos, AnimationId) override;
+  virtual int getTimeMilli() override;
+  virtual int getTimeMilliAbsolute() override;
+  virtual void stopClock() override;
+  virtual void continueClock() override;
+  virtual bool isClockStopped() override;
+};
+
+#endif
@@ -0,0 +1,74 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+
+
+#include "stdafx.h"
+
+#include "path_batch.h"
+#include "profiler.h"
+
+static WorkerPool& getWorkers() {
+  static WorkerPool workers(max(0, int(thread::hardware_concurrency()) - 1));
+  return workers;
+}
+
+int PathBatch::add(const Level* level, const Creature* creature, Vec2 target, Vec2 from, double mult) {
+  queries.push_back([=] { return ShortestPath(level, creature, target, from, mult); });
+  results.push_back(none);
+  return queries.size() - 1;
+}
+
+int PathBatch::add(Rectangle area, function<double(Vec2)> entryFun, Vec2 target, Vec2 from) {
+  queries.push_back([=] {
+      return ShortestPath(area, entryFun, [](Vec2 v) { return v.length8(); }, Vec2::directions8(),
+          target, from); });
+  results.push_back(none);
+  return queries.size() - 1;
+}
+
+// Smaller batches are searched on the calling thread, as waking up the workers would cost more.
+const int minParallelQueries = 4;
+
+void PathBatch::run() {
+  PROFILE_ZONE("PathBatch::run");
+  vector<int> pending;
+  for (int i : All(queries))
+    if (!results[i])
+      pending.push_back(i);
+  if (pending.size() < minParallelQueries) {
+    for (int query : pending)
+      results[query] = queries[query]();
+    return;
+  }
+  // Every job writes only its own result.
+  getWorkers().run(pending.size(), [&](int index) {
+      PROFILE_ZONE("PathBatch::job");
+      int query = pending[index];
+      results[query] = queries[query]();
+  });
+}
+
+int PathBatch::getSize() const {
+  return queries.size();
+}
+
+const ShortestPath& PathBatch::getPath(int index) const {
+  CHECK(results[index]) << "Path batch wasn't run";
+  return *results[index];
+}
+
+int PathBatch::getNumThreads() {
+  return getWorkers().getNumThreads() + 1;
+}
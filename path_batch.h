@@ -0,0 +1,52 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+
+
+#ifndef _PATH_BATCH_H
+#define _PATH_BATCH_H
+
+#include "util.h"
+#include "shortest_path.h"
+
+class Level;
+class Creature;
+
+/**
+  * Path queries that are collected and then searched for together on the worker threads. The
+  * searches only read the levels and creatures, so they must not change until run() returns.
+  */
+class PathBatch {
+  public:
+  /** Adds a query with the same arguments as the ShortestPath constructor. Returns its index.*/
+  int add(const Level*, const Creature*, Vec2 target, Vec2 from, double mult = 0);
+  int add(Rectangle area, function<double(Vec2)> entryFun, Vec2 target, Vec2 from);
+
+  /** Finds all paths that weren't found yet. Only a few paths are found on the calling thread.*/
+  void run();
+
+  int getSize() const;
+
+  /** Result of the query with the given index, only valid after run().*/
+  const ShortestPath& getPath(int index) const;
+
+  /** Number of threads used by run(), including the calling one.*/
+  static int getNumThreads();
+
+  private:
+  vector<function<ShortestPath()>> queries;
+  vector<optional<ShortestPath>> results;
+};
+
+#endif
@@ -0,0 +1,260 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+
+
+#include "stdafx.h"
+
+#include "path_clusters.h"
+#include "shortest_path.h"
+#include "bucket_queue.h"
+#include "profiler.h"
+
+// Enough to reach any square of a cluster.
+const int maxClusterDist = 1000000;
+
+static Rectangle getClusterBounds(Rectangle bounds) {
+  return Rectangle((bounds.getW() + PathClusters::clusterSize - 1) / PathClusters::clusterSize,
+      (bounds.getH() + PathClusters::clusterSize - 1) / PathClusters::clusterSize);
+}
+
+PathClusters::PathClusters(Rectangle b, EntryFun f) : bounds(b), entryFun(f), clusters(getClusterBounds(b)),
+    eastTransitions(clusters.getBounds()), southTransitions(clusters.getBounds()),
+    southEastTransitions(clusters.getBounds()), southWestTransitions(clusters.getBounds()) {
+  for (Vec2 v : clusters.getBounds())
+    dirtyClusters.push_back(v);
+}
+
+Vec2 PathClusters::getCluster(Vec2 pos) const {
+  return Vec2((pos.x - bounds.getPX()) / clusterSize, (pos.y - bounds.getPY()) / clusterSize);
+}
+
+Rectangle PathClusters::getArea(Vec2 cluster) const {
+  Vec2 topLeft = bounds.getTopLeft() + cluster * clusterSize;
+  return bounds.intersection(Rectangle(topLeft, topLeft + Vec2(clusterSize, clusterSize)));
+}
+
+bool PathClusters::isPassable(Vec2 pos) const {
+  return entryFun(pos) < ShortestPath::infinity;
+}
+
+void PathClusters::invalidate(Vec2 pos) {
+  Vec2 cluster = getCluster(pos);
+  if (!clusters[cluster].dirty) {
+    clusters[cluster].dirty = true;
+    dirtyClusters.push_back(cluster);
+  }
+}
+
+void PathClusters::update() {
+  if (dirtyClusters.empty())
+    return;
+  PROFILE_ZONE("PathClusters::update");
+  for (Vec2 cluster : dirtyClusters)
+    for (Vec2 dir : Vec2::directions8()) {
+      Vec2 neighbor = cluster + dir;
+      if (!neighbor.inRectangle(clusters.getBounds()))
+        continue;
+      // Transitions are stored with the cluster to the north or west.
+      bool forward = dir.y > 0 || (dir.y == 0 && dir.x > 0);
+      Vec2 from = forward ? cluster : neighbor;
+      Vec2 to = forward ? dir : -dir;
+      if (to.x != 0 && to.y != 0)
+        updateCornerTransition(from, to);
+      else
+        updateTransitions(from, to);
+    }
+  // The neighbors' edges must be rebuilt too, because their transitions might have changed.
+  set<Vec2> toUpdate;
+  for (Vec2 cluster : dirtyClusters) {
+    toUpdate.insert(cluster);
+    for (Vec2 v : cluster.neighbors8())
+      if (v.inRectangle(clusters.getBounds()))
+        toUpdate.insert(v);
+  }
+  for (Vec2 cluster : toUpdate)
+    updateEdges(cluster);
+  for (Vec2 cluster : dirtyClusters)
+    clusters[cluster].dirty = false;
+  dirtyClusters.clear();
+}
+
+void PathClusters::updateTransitions(Vec2 cluster, Vec2 dir) {
+  vector<pair<Vec2, Vec2>>& transitions = dir.x > 0 ? eastTransitions[cluster] : southTransitions[cluster];
+  transitions.clear();
+  Rectangle area = getArea(cluster);
+  Vec2 along(dir.y, dir.x);
+  Vec2 start = dir.x > 0 ? Vec2(area.getKX() - 1, area.getPY()) : Vec2(area.getPX(), area.getKY() - 1);
+  int length = dir.x > 0 ? area.getH() : area.getW();
+  vector<bool> open(length);
+  for (int i : Range(length))
+    open[i] = isPassable(start + along * i) && isPassable(start + along * i + dir);
+  int runStart = -1;
+  for (int i = 0; i <= length; ++i) {
+    if (i < length && open[i] && runStart == -1)
+      runStart = i;
+    if ((i == length || !open[i]) && runStart > -1) {
+      Vec2 middle = start + along * ((runStart + i - 1) / 2);
+      transitions.push_back({middle, middle + dir});
+      runStart = -1;
+    }
+  }
+  // A diagonal step across the border only needs its own transition if neither of its ends
+  // can cross straight.
+  for (int i : Range(length))
+    for (int j : {i - 1, i + 1})
+      if (j >= 0 && j < length && !open[i] && !open[j] && isPassable(start + along * i)
+          && isPassable(start + along * j + dir))
+        transitions.push_back({start + along * i, start + along * j + dir});
+}
+
+void PathClusters::updateCornerTransition(Vec2 cluster, Vec2 dir) {
+  vector<pair<Vec2, Vec2>>& transitions = dir.x > 0 ? southEastTransitions[cluster]
+      : southWestTransitions[cluster];
+  transitions.clear();
+  Rectangle area = getArea(cluster);
+  Vec2 corner(dir.x > 0 ? area.getKX() - 1 : area.getPX(), area.getKY() - 1);
+  if (isPassable(corner) && isPassable(corner + dir))
+    transitions.push_back({corner, corner + dir});
+}
+
+void PathClusters::updateEdges(Vec2 clusterPos) {
+  Cluster& cluster = clusters[clusterPos];
+  cluster.nodes.clear();
+  cluster.edges.clear();
+  auto addCrossing = [&](Vec2 inside, Vec2 outside) {
+    if (!cluster.edges.count(inside))
+      cluster.nodes.push_back(inside);
+    cluster.edges[inside].push_back({outside, entryFun(outside)});
+  };
+  for (auto& t : eastTransitions[clusterPos])
+    addCrossing(t.first, t.second);
+  for (auto& t : southTransitions[clusterPos])
+    addCrossing(t.first, t.second);
+  if (clusterPos.x > 0)
+    for (auto& t : eastTransitions[clusterPos - Vec2(1, 0)])
+      addCrossing(t.second, t.first);
+  if (clusterPos.y > 0)
+    for (auto& t : southTransitions[clusterPos - Vec2(0, 1)])
+      addCrossing(t.second, t.first);
+  for (auto& t : southEastTransitions[clusterPos])
+    addCrossing(t.first, t.second);
+  for (auto& t : southWestTransitions[clusterPos])
+    addCrossing(t.first, t.second);
+  if (clusterPos.x > 0 && clusterPos.y > 0)
+    for (auto& t : southEastTransitions[clusterPos - Vec2(1, 1)])
+      addCrossing(t.second, t.first);
+  if (clusterPos.x < clusters.getWidth() - 1 && clusterPos.y > 0)
+    for (auto& t : southWestTransitions[clusterPos + Vec2(1, -1)])
+      addCrossing(t.second, t.first);
+  Rectangle area = getArea(clusterPos);
+  cluster.uniformCost = ShortestPath::infinity;
+  for (Vec2 v : area) {
+    double cost = entryFun(v);
+    if (cost < ShortestPath::infinity && cost != *cluster.uniformCost) {
+      if (*cluster.uniformCost < ShortestPath::infinity) {
+        cluster.uniformCost = none;
+        break;
+      }
+      cluster.uniformCost = cost;
+    }
+  }
+  for (Vec2 node : cluster.nodes) {
+    Dijkstra dijkstra(area, node, maxClusterDist, entryFun);
+    vector<Edge>& edges = cluster.edges[node];
+    for (Vec2 other : cluster.nodes)
+      if (other != node && dijkstra.isReachable(other))
+        edges.push_back({other, dijkstra.getDist(other)});
+  }
+}
+
+namespace {
+
+struct AbstractElem {
+  Vec2 pos;
+  double dist;
+};
+
+}
+
+bool PathClusters::isUniform(Rectangle area) {
+  update();
+  area = area.intersection(bounds);
+  Vec2 first = getCluster(area.getTopLeft());
+  Vec2 last = getCluster(area.getBottomRight() - Vec2(1, 1));
+  double cost = ShortestPath::infinity;
+  for (Vec2 cluster : Rectangle(first, last + Vec2(1, 1))) {
+    optional<double> clusterCost = clusters[cluster].uniformCost;
+    if (!clusterCost)
+      return false;
+    if (*clusterCost < ShortestPath::infinity) {
+      if (cost < ShortestPath::infinity && cost != *clusterCost)
+        return false;
+      cost = *clusterCost;
+    }
+  }
+  return true;
+}
+
+optional<vector<Vec2>> PathClusters::findWaypoints(Vec2 from, Vec2 to) {
+  PROFILE_ZONE("PathClusters::findWaypoints");
+  CHECK(from.inRectangle(bounds) && to.inRectangle(bounds));
+  update();
+  Vec2 fromCluster = getCluster(from);
+  Vec2 toCluster = getCluster(to);
+  // The endpoints are connected to the transitions of their clusters. Entering the target from a
+  // transition is assumed to cost the same as the other way around.
+  Dijkstra fromDist(getArea(fromCluster), from, maxClusterDist, entryFun);
+  Dijkstra toDist(getArea(toCluster), to, maxClusterDist, entryFun);
+  unordered_map<Vec2, double> distance;
+  unordered_map<Vec2, Vec2> parent;
+  BucketQueue<AbstractElem> queue;
+  auto getKey = [&](Vec2 pos, double dist) { return getBucketKey(dist + (to - pos).length8()); };
+  auto relax = [&](Vec2 pos, Vec2 next, double dist) {
+    auto it = distance.find(next);
+    if (it == distance.end() || dist < it->second) {
+      distance[next] = dist;
+      parent[next] = pos;
+      queue.push({next, dist}, getKey(next, dist));
+    }
+  };
+  distance[from] = 0;
+  queue.push({from, 0}, getKey(from, 0));
+  while (!queue.isEmpty()) {
+    AbstractElem elem = queue.pop();
+    if (elem.dist > distance.at(elem.pos))
+      continue;
+    Vec2 pos = elem.pos;
+    if (pos == to) {
+      vector<Vec2> ret {to};
+      while (ret.back() != from)
+        ret.push_back(parent.at(ret.back()));
+      std::reverse(ret.begin(), ret.end());
+      return ret;
+    }
+    Vec2 cluster = getCluster(pos);
+    if (cluster == toCluster && toDist.isReachable(pos))
+      relax(pos, to, elem.dist + toDist.getDist(pos));
+    if (pos == from) {
+      for (Vec2 node : clusters[fromCluster].nodes)
+        if (node != from && fromDist.isReachable(node))
+          relax(pos, node, fromDist.getDist(node));
+    }
+    auto edges = clusters[cluster].edges.find(pos);
+    if (edges != clusters[cluster].edges.end())
+      for (const Edge& edge : edges->second)
+        relax(pos, edge.to, elem.dist + edge.cost);
+  }
+  return none;
+}
@@ -0,0 +1,82 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+
+
+#ifndef _PATH_CLUSTERS_H
+#define _PATH_CLUSTERS_H
+
+#include "util.h"
+#include "shortest_path.h"
+
+/**
+  * Abstract graph for hierarchical pathfinding (HPA*). The area is divided into square clusters,
+  * every passable stretch of the border between two clusters gets a transition in its middle, as does
+  * every diagonal step into another cluster that can't cross straight, and the transitions of each
+  * cluster are connected with the lengths of the shortest paths inside the cluster.
+  * Long paths are first found in this small graph, and then refined by searching only between
+  * consecutive waypoints. A changed square only invalidates its cluster, which is rebuilt on the next query.
+  */
+class PathClusters {
+  public:
+  PathClusters(Rectangle bounds, EntryFun entryFun);
+
+  /** Marks the cluster containing the square for rebuilding.*/
+  void invalidate(Vec2);
+
+  /** Returns waypoints from \paramname{from} to \paramname{to}, both included. Two consecutive
+      waypoints are either neighbors or lie in a common cluster.*/
+  optional<vector<Vec2>> findWaypoints(Vec2 from, Vec2 to);
+
+  /** Checks if all passable squares in the area have the same cost.*/
+  bool isUniform(Rectangle area);
+
+  static const int clusterSize = 16;
+
+  private:
+  struct Edge {
+    Vec2 to;
+    double cost;
+  };
+
+  struct Cluster {
+    vector<Vec2> nodes;
+    unordered_map<Vec2, vector<Edge>> edges;
+    /** Cost of the passable squares if it's the same for all of them, ShortestPath::infinity if there
+        are none, and none if they differ.*/
+    optional<double> uniformCost;
+    bool dirty = true;
+  };
+
+  Vec2 getCluster(Vec2 pos) const;
+  Rectangle getArea(Vec2 cluster) const;
+  bool isPassable(Vec2) const;
+  void update();
+  void updateTransitions(Vec2 cluster, Vec2 dir);
+  void updateCornerTransition(Vec2 cluster, Vec2 dir);
+  void updateEdges(Vec2 cluster);
+
+  Rectangle bounds;
+  EntryFun entryFun;
+  Table<Cluster> clusters;
+  /** Pairs of neighboring squares that connect each cluster with the one to the east, south, south-east
+      and south-west. The last two only hold the diagonal step between the corners.*/
+  Table<vector<pair<Vec2, Vec2>>> eastTransitions;
+  Table<vector<pair<Vec2, Vec2>>> southTransitions;
+  Table<vector<pair<Vec2, Vec2>>> southEastTransitions;
+  Table<vector<pair<Vec2, Vec2>>> southWestTransitions;
+  vector<Vec2> dirtyClusters;
+};
+
+#endif
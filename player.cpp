@@ -28,6 +28,7 @@
 #include "item_factory.h"
 #include "effect.h"
 #include "view_id.h"
+#include "profiler.h"
 #include "map_memory.h"
 
 template <class Archive> 
@@ -489,9 +490,8 @@ void Player::sleeping() {
     ViewObject::setHallu(true);
   else
     ViewObject::setHallu(false);
-  MEASURE(
-      model->getView()->updateView(this, false),
-      "level render time");
+  PROFILE_ZONE("Player::updateView");
+  model->getView()->updateView(this, false);
 }
 
 static bool displayTravelInfo = true;
@@ -529,9 +529,8 @@ void Player::makeMove() {
       getViewIndex(pos, index);
       (*levelMemory)[getCreature()->getLevel()->getUniqueId()].update(pos, index);
     }
-    MEASURE(
-        model->getView()->updateView(this, false),
-        "level render time");
+    PROFILE_ZONE("Player::updateView");
+    model->getView()->updateView(this, false);
   }
   if (displayTravelInfo && getCreature()->getSquare()->getName() == "road" 
       && model->getOptions()->getBoolValue(OptionId::HINTS)) {
@@ -907,7 +907,7 @@ void PlayerControl::initialize() {
 }
 
 void PlayerControl::update(Creature* c) {
-  if (!retired && contains(getCollective()->getCreatures(), c)) {
+  if (!retired) {
     vector<Vec2> visibleTiles = getCollective()->getLevel()->getVisibleTiles(c);
     visibilityMap.update(c, visibleTiles);
     for (Vec2 pos : visibleTiles) {
@@ -1082,7 +1082,7 @@ class MinionController : public Player {
 };
 
 void PlayerControl::controlSingle(const Creature* cr) {
-  CHECK(contains(getCreatures(), cr));
+  CHECK(getCollective()->hasCreature(cr));
   CHECK(!cr->isDead());
   Creature* c = const_cast<Creature*>(cr);
   commandTeam(getCollective()->getTeams().create({c}));
@@ -1506,7 +1506,7 @@ void PlayerControl::tick(double time) {
   }
   vector<Creature*> addedCreatures;
   for (const Creature* c : visibleFriends)
-    if (c->getSpawnType() && !contains(getCreatures(), c)) {
+    if (c->getSpawnType() && !getCollective()->hasCreature(c)) {
       addedCreatures.push_back(const_cast<Creature*>(c));
       getCollective()->addCreature(const_cast<Creature*>(c), {MinionTrait::FIGHTER});
     }
@@ -1655,7 +1655,7 @@ void PlayerControl::onWorshipEvent(Creature* who, const Deity* to, WorshipType t
     model->getView()->presentText("", "A shrine to " + to->getName() + " has been devastated by " + who->getName().a() + ".");
     return;
   }
-  if (!contains(getCreatures(), who))
+  if (!getCollective()->hasCreature(who))
     return;
   for (EpithetId id : to->getEpithets())
     switch (id) {
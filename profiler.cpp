@@ -0,0 +1,160 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+#include "stdafx.h"
+
+#include <chrono>
+
+#include "profiler.h"
+
+namespace {
+
+const int maxZones = 512;
+const int maxNodes = 2048;
+
+// A zone called from a particular call path. Stats are written only by the owning thread,
+// but can be read by the thread that dumps them.
+struct Node {
+  int zone;
+  int parent;
+  atomic<long long> count;
+  atomic<long long> total;
+  atomic<long long> max;
+  // Used only by the dumping thread.
+  long long dumpedCount;
+  long long dumpedTotal;
+};
+
+struct ThreadData {
+  ThreadData(int i) : index(i) {
+    nodes[0].zone = -1;
+    nodes[0].parent = -1;
+  }
+
+  int getChild(int zone) {
+    for (auto& elem : children[current])
+      if (elem.first == zone)
+        return elem.second;
+    int node = numNodes;
+    // When out of nodes, the zone is just added to its parent.
+    if (node >= maxNodes)
+      return current;
+    nodes[node].zone = zone;
+    nodes[node].parent = current;
+    nodes[node].count = nodes[node].total = nodes[node].max = 0;
+    nodes[node].dumpedCount = nodes[node].dumpedTotal = 0;
+    children[current].push_back({zone, node});
+    children.emplace_back();
+    numNodes.store(node + 1, std::memory_order_release);
+    return node;
+  }
+
+  const int index;
+  Node nodes[maxNodes];
+  atomic<int> numNodes {1};
+  int current = 0;
+  vector<vector<pair<int, int>>> children = vector<vector<pair<int, int>>>(1);
+};
+
+std::mutex registryMutex;
+const char* zoneNames[maxZones];
+atomic<int> numZones {0};
+vector<unique_ptr<ThreadData>> threads;
+
+ThreadData& getThreadData() {
+  thread_local ThreadData* data = nullptr;
+  if (!data) {
+    std::unique_lock<std::mutex> lock(registryMutex);
+    threads.emplace_back(new ThreadData(threads.size()));
+    data = threads.back().get();
+  }
+  return *data;
+}
+
+string outputPath;
+int dumpFrequency = 0;
+double lastDump = -1;
+
+}
+
+int Profiler::getZoneId(const char* name) {
+  std::unique_lock<std::mutex> lock(registryMutex);
+  for (int i : Range(numZones))
+    if (!strcmp(zoneNames[i], name))
+      return i;
+  CHECK(numZones < maxZones) << "Too many profiler zones";
+  zoneNames[numZones] = name;
+  return numZones++;
+}
+
+long long Profiler::getMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Profiler::Zone::Zone(int id) {
+  ThreadData& data = getThreadData();
+  parent = data.current;
+  data.current = data.getChild(id);
+  start = getMicros();
+}
+
+Profiler::Zone::~Zone() {
+  long long time = getMicros() - start;
+  ThreadData& data = getThreadData();
+  Node& node = data.nodes[data.current];
+  node.count.store(node.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  node.total.store(node.total.load(std::memory_order_relaxed) + time, std::memory_order_relaxed);
+  if (time > node.max.load(std::memory_order_relaxed))
+    node.max.store(time, std::memory_order_relaxed);
+  data.current = parent;
+}
+
+void Profiler::setOutput(const string& path, int numTurns) {
+  outputPath = path;
+  dumpFrequency = numTurns;
+  ofstream(path) << "turn,thread,zone,calls,total ms,max ms" << endl;
+}
+
+void Profiler::onTurn(double time) {
+  if (dumpFrequency > 0 && time >= lastDump + dumpFrequency) {
+    if (lastDump >= 0)
+      dump(outputPath, time);
+    lastDump = time;
+  }
+}
+
+static string getPath(const ThreadData& data, int node) {
+  string ret;
+  for (; node > 0; node = data.nodes[node].parent)
+    ret = zoneNames[data.nodes[node].zone] + (ret.empty() ? "" : "/" + ret);
+  return ret;
+}
+
+void Profiler::dump(const string& path, double time) {
+  ofstream out(path, std::ios::app);
+  std::unique_lock<std::mutex> lock(registryMutex);
+  for (auto& data : threads)
+    for (int i : Range(1, data->numNodes.load(std::memory_order_acquire))) {
+      Node& node = data->nodes[i];
+      long long count = node.count.load(std::memory_order_relaxed);
+      long long total = node.total.load(std::memory_order_relaxed);
+      long long max = node.max.exchange(0, std::memory_order_relaxed);
+      if (count > node.dumpedCount)
+        out << int(time) << "," << data->index << "," << getPath(*data, i) << "," << count - node.dumpedCount
+            << "," << double(total - node.dumpedTotal) / 1000 << "," << double(max) / 1000 << endl;
+      node.dumpedCount = count;
+      node.dumpedTotal = total;
+    }
+}
@@ -0,0 +1,59 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include "util.h"
+
+/**
+  * Hierarchical profiler. Put PROFILE_ZONE("name") at the beginning of a scope to measure
+  * its time. Zones are aggregated per thread by their call path, eg. "Model::update/Model::tick",
+  * with number of calls, total and maximum time. Recording is cheap enough to stay enabled in release builds.
+  */
+class Profiler {
+  public:
+  /** Registers a zone and returns its id. The name must be a string literal.*/
+  static int getZoneId(const char* name);
+
+  /** Microseconds from an arbitrary point in time.*/
+  static long long getMicros();
+
+  class Zone {
+    public:
+    Zone(int id);
+    ~Zone();
+
+    private:
+    long long start;
+    int parent;
+  };
+
+  /** Start appending aggregated statistics to the given CSV file every numTurns turns.*/
+  static void setOutput(const string& path, int numTurns);
+
+  /** Called every turn, writes out the statistics if it's time to do so.*/
+  static void onTurn(double time);
+
+  /** Appends statistics gathered since the last dump to the file.*/
+  static void dump(const string& path, double time);
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_ZONE(name) \
+  static const int PROFILE_CONCAT(profileId, __LINE__) = Profiler::getZoneId(name); \
+  Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(PROFILE_CONCAT(profileId, __LINE__))
+
+#endif
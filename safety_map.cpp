@@ -0,0 +1,115 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+
+
+#include "stdafx.h"
+
+#include "safety_map.h"
+#include "shortest_path.h"
+#include "bucket_queue.h"
+#include "profiler.h"
+
+// How much safer a square is for every step of distance from the threats.
+const double distanceMult = -1.5;
+
+static Rectangle getMapBounds(Rectangle levelBounds, const vector<Vec2>& threats) {
+  CHECK(!threats.empty());
+  Rectangle box = Rectangle::boundingBox(threats);
+  return levelBounds.intersection(Rectangle(box.getTopLeft() - Vec2(1, 1) * (SafetyMap::range + 1),
+      box.getBottomRight() + Vec2(1, 1) * (SafetyMap::range + 1)));
+}
+
+namespace {
+
+struct QueueElem {
+  Vec2 pos;
+  double value;
+};
+
+}
+
+SafetyMap::SafetyMap(Rectangle levelBounds, vector<Vec2> t, EntryFun entryFun)
+    : threats(t), bounds(getMapBounds(levelBounds, threats)), safety(bounds, ShortestPath::infinity) {
+  PROFILE_ZONE("SafetyMap::SafetyMap");
+  BucketQueue<QueueElem> queue;
+  // Distances from the threats, the ones beyond the range aren't expanded.
+  for (Vec2 v : threats) {
+    CHECK(v.inRectangle(bounds));
+    safety[v] = 0;
+    queue.push({v, 0}, 0);
+  }
+  while (!queue.isEmpty()) {
+    QueueElem elem = queue.pop();
+    if (elem.value > safety[elem.pos] || elem.value >= range)
+      continue;
+    for (Vec2 dir : Vec2::directions8()) {
+      Vec2 next = elem.pos + dir;
+      if (next.inRectangle(bounds)) {
+        double value = elem.value + entryFun(next);
+        if (value < safety[next]) {
+          safety[next] = value;
+          queue.push({next, value}, getBucketKey(value));
+        }
+      }
+    }
+  }
+  queue.clear();
+  for (Vec2 v : bounds)
+    if (safety[v] <= range) {
+      safety[v] *= distanceMult;
+      queue.push({v, safety[v]}, getBucketKey(safety[v]));
+    }
+  // Spread the safety, but only within the range.
+  while (!queue.isEmpty()) {
+    QueueElem elem = queue.pop();
+    if (elem.value > safety[elem.pos])
+      continue;
+    for (Vec2 dir : Vec2::directions8()) {
+      Vec2 next = elem.pos + dir;
+      if (next.inRectangle(bounds)) {
+        double value = elem.value + entryFun(next);
+        if (value < safety[next] && safety[next] < 0) {
+          safety[next] = value;
+          queue.push({next, value}, getBucketKey(value));
+        }
+      }
+    }
+  }
+}
+
+const vector<Vec2>& SafetyMap::getThreats() const {
+  return threats;
+}
+
+Rectangle SafetyMap::getBounds() const {
+  return bounds;
+}
+
+double SafetyMap::getSafety(Vec2 pos) const {
+  if (!pos.inRectangle(bounds) || safety[pos] >= 0)
+    return ShortestPath::infinity;
+  return safety[pos];
+}
+
+vector<Vec2> SafetyMap::getSaferMoves(Vec2 pos) const {
+  double value = getSafety(pos);
+  vector<pair<double, Vec2>> moves;
+  if (value < ShortestPath::infinity)
+    for (Vec2 next : pos.neighbors8())
+      if (getSafety(next) < value)
+        moves.push_back({getSafety(next), next});
+  sort(moves.begin(), moves.end());
+  return transform2<Vec2>(moves, [](const pair<double, Vec2>& m) { return m.second; });
+}
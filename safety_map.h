@@ -0,0 +1,52 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+
+
+#ifndef _SAFETY_MAP_H
+#define _SAFETY_MAP_H
+
+#include "util.h"
+#include "shortest_path.h"
+
+/**
+  * Tells creatures fleeing from a group of threats where to go. Squares within the threats' range get
+  * the distance to the closest threat, negated and scaled, so the farthest squares are the safest. The
+  * safety then spreads to squares from which the safe ones are cheap to reach, so creatures don't flee
+  * into dead ends. The map covers only the threats' range, and can be shared by all creatures fleeing
+  * from the same threats.
+  */
+class SafetyMap {
+  public:
+  SafetyMap(Rectangle levelBounds, vector<Vec2> threats, EntryFun entryFun);
+
+  const vector<Vec2>& getThreats() const;
+  Rectangle getBounds() const;
+
+  /** Lower is safer. Squares beyond the threats' range are infinitely unsafe, and don't lead anywhere.*/
+  double getSafety(Vec2) const;
+
+  /** Neighbors that are safer than the square, safest first.*/
+  vector<Vec2> getSaferMoves(Vec2) const;
+
+  /** Distance from the threats beyond which squares are out of their range.*/
+  static const int range = 15;
+
+  private:
+  vector<Vec2> threats;
+  Rectangle bounds;
+  Table<double> safety;
+};
+
+#endif
@@ -15,56 +15,68 @@
 
 #include "stdafx.h"
 #include "sectors.h"
-#include "level.h"
 
 template <class Archive> 
 void Sectors::serialize(Archive& ar, const unsigned int version) {
+  if (version == 0) { // OBSOLETE
+    Table<int> SERIAL(sectors);
+    ar& SVAR(bounds)
+      & SVAR(sectors)
+      & SVAR(sizes);
+    *this = Sectors(bounds);
+    for (Vec2 v : bounds)
+      if (sectors[v] > -1)
+        add(v);
+    return;
+  }
   ar& SVAR(bounds)
-    & SVAR(sectors)
+    & SVAR(numChunksX)
+    & SVAR(local)
+    & SVAR(numComponents)
+    & SVAR(nodeSector)
     & SVAR(sizes);
 }
 
 SERIALIZABLE(Sectors);
 SERIALIZATION_CONSTRUCTOR_IMPL(Sectors);
 
-Sectors::Sectors(Rectangle b) : bounds(b), sectors(bounds, -1) {
+static int getNumChunks(int length) {
+  return (length + Sectors::chunkSize - 1) / Sectors::chunkSize;
 }
 
-bool Sectors::same(Vec2 v, Vec2 w) const {
-  return contains(v) && sectors[v] == sectors[w];
+Sectors::Sectors(Rectangle b) : bounds(b), numChunksX(getNumChunks(b.getW())), local(bounds, -1),
+    numComponents(numChunksX * getNumChunks(b.getH()), 0), nodeSector(numComponents.size() * chunkArea, -1) {
 }
 
-bool Sectors::contains(Vec2 v) const {
-  return sectors[v] > -1;
+int Sectors::getChunk(Vec2 v) const {
+  return (v.x - bounds.getPX()) / chunkSize + numChunksX * ((v.y - bounds.getPY()) / chunkSize);
 }
 
-void Sectors::add(Vec2 pos) {
-  if (contains(pos))
-    return;
-  set<int> neighbors;
-  for (Vec2 v : pos.neighbors8())
-    if (v.inRectangle(bounds) && contains(v))
-      neighbors.insert(sectors[v]);
-  if (neighbors.size() == 0)
-    setSector(pos, getNewSector());
-  else
-  if (neighbors.size() == 1)
-    setSector(pos, *neighbors.begin());
-  else {
-    int largest = -1;
-    for (int elem : neighbors)
-      if (largest == -1 || sizes[largest] < sizes[elem])
-        largest = elem;
-    join(pos, largest);
-  }
+Rectangle Sectors::getChunkBounds(int chunk) const {
+  int px = bounds.getPX() + (chunk % numChunksX) * chunkSize;
+  int py = bounds.getPY() + (chunk / numChunksX) * chunkSize;
+  return Rectangle(px, py, min(bounds.getKX(), px + chunkSize), min(bounds.getKY(), py + chunkSize));
 }
 
-void Sectors::setSector(Vec2 pos, int sector) {
-  CHECK(sectors[pos] != sector);
-  if (contains(pos))
-    --sizes[sectors[pos]];
-  sectors[pos] = sector;
-  ++sizes[sector];
+int Sectors::getNode(Vec2 v) const {
+  return getChunk(v) * chunkArea + local[v];
+}
+
+bool Sectors::same(Vec2 v, Vec2 w) const {
+  return contains(v) && contains(w) && nodeSector[getNode(v)] == nodeSector[getNode(w)];
+}
+
+bool Sectors::contains(Vec2 v) const {
+  return local[v] > -1;
+}
+
+void Sectors::setSector(int node, int sector) {
+  CHECK(nodeSector[node] != sector);
+  if (nodeSector[node] > -1)
+    --sizes[nodeSector[node]];
+  nodeSector[node] = sector;
+  if (sector > -1)
+    ++sizes[sector];
 }
 
 int Sectors::getNewSector() {
@@ -80,68 +92,295 @@ int Sectors::getNumSectors() const {
   return ret;
 }
 
-void Sectors::join(Vec2 pos1, int sector) {
-  queue<Vec2> q;
-  q.push(pos1);
-  setSector(pos1, sector);
-  while (!q.empty()) {
-    Vec2 pos = q.front();
-    q.pop();
-    for (Vec2 v : pos.neighbors8())
-      if (v.inRectangle(bounds) && sectors[v] > -1 && sectors[v] != sector) {
-        setSector(v, sector);
-        q.push(v);
+int Sectors::labelChunk(int chunk) {
+  Rectangle area = getChunkBounds(chunk);
+  const int unlabeled = chunkArea;
+  for (Vec2 v : area)
+    if (contains(v))
+      local[v] = unlabeled;
+  int num = 0;
+  for (Vec2 v : area)
+    if (local[v] == unlabeled)
+      fillChunk(v, unlabeled, num++);
+  return num;
+}
+
+/** Calls fun(v, w) for all adjacent squares v inside the chunk and w outside of it.*/
+template <class Fun>
+static void forEachBorderPair(Rectangle bounds, Rectangle area, Fun fun) {
+  for (int x = area.getPX(); x < area.getKX(); ++x)
+    for (int dx = -1; dx <= 1; ++dx)
+      if (x + dx >= bounds.getPX() && x + dx < bounds.getKX()) {
+        if (area.getPY() > bounds.getPY())
+          fun(Vec2(x, area.getPY()), Vec2(x + dx, area.getPY() - 1));
+        if (area.getKY() < bounds.getKY())
+          fun(Vec2(x, area.getKY() - 1), Vec2(x + dx, area.getKY()));
+      }
+  for (int y = area.getPY(); y < area.getKY(); ++y)
+    for (int dy = -1; dy <= 1; ++dy)
+      if (y + dy >= area.getPY() && y + dy < area.getKY()) {
+        if (area.getPX() > bounds.getPX())
+          fun(Vec2(area.getPX(), y), Vec2(area.getPX() - 1, y + dy));
+        if (area.getKX() < bounds.getKX())
+          fun(Vec2(area.getKX() - 1, y), Vec2(area.getKX(), y + dy));
       }
-  }
 }
 
-static DirtyTable<int> bfsTable(Level::getMaxBounds(), -1);
+const vector<int>& Sectors::getNeighbors(int node) {
+  if (neighbors.count(node))
+    return neighbors.at(node);
+  vector<int>& ret = neighbors[node];
+  int component = node % chunkArea;
+  forEachBorderPair(bounds, getChunkBounds(node / chunkArea), [&](Vec2 v, Vec2 w) {
+    if (local[v] == component && contains(w))
+      ret.push_back(getNode(w));
+  });
+  sort(ret.begin(), ret.end());
+  ret.erase(unique(ret.begin(), ret.end()), ret.end());
+  return ret;
+}
+
+void Sectors::invalidateNeighbors(int chunk) {
+  int x = chunk % numChunksX;
+  int y = chunk / numChunksX;
+  for (int i : Range(max(0, x - 1), min(numChunksX, x + 2)))
+    for (int j : Range(max(0, y - 1), min<int>(numComponents.size() / numChunksX, y + 2))) {
+      int c = i + j * numChunksX;
+      for (int k : Range(numComponents[c]))
+        neighbors.erase(c * chunkArea + k);
+    }
+}
+
+static bool onBorder(Vec2 v, Rectangle area) {
+  return v.x == area.getPX() || v.y == area.getPY() || v.x == area.getKX() - 1 || v.y == area.getKY() - 1;
+}
+
+/** Components of other chunks adjacent to the given chunk's squares.*/
+void Sectors::getOutsideNeighbors(int chunk, vector<int>& ret) const {
+  forEachBorderPair(bounds, getChunkBounds(chunk), [&](Vec2 v, Vec2 w) {
+    if (contains(v) && contains(w))
+      ret.push_back(getNode(w));
+  });
+}
+
+void Sectors::add(Vec2 pos) {
+  if (contains(pos))
+    return;
+  int chunk = getChunk(pos);
+  Rectangle area = getChunkBounds(chunk);
+  vector<int> labels;
+  vector<int> outside;
+  for (Vec2 v : pos.neighbors8())
+    if (v.inRectangle(bounds) && contains(v)) {
+      if (v.inRectangle(area))
+        labels.push_back(local[v]);
+      else
+        outside.push_back(getNode(v));
+    }
+  sort(labels.begin(), labels.end());
+  labels.erase(unique(labels.begin(), labels.end()), labels.end());
+  if (labels.empty() && numComponents[chunk] == chunkArea) {
+    rebuildChunk(pos, true);
+    return;
+  }
+  local[pos] = labels.empty() ? numComponents[chunk]++ : labels[0];
+  int node = getNode(pos);
+  // All other components of the chunk around the square are merged into the first one.
+  int sector = nodeSector[node];
+  for (int i = 1; i < labels.size(); ++i) {
+    int merged = chunk * chunkArea + labels[i];
+    if (sector == -1 || sizes[sector] < sizes[nodeSector[merged]])
+      sector = nodeSector[merged];
+    setSector(merged, -1);
+    for (Vec2 v : pos.neighbors8())
+      if (v.inRectangle(area) && local[v] == labels[i])
+        fillChunk(v, labels[i], labels[0]);
+  }
+  for (int w : outside)
+    if (sector == -1 || sizes[sector] < sizes[nodeSector[w]])
+      sector = nodeSector[w];
+  if (sector == -1)
+    sector = getNewSector();
+  // New connections all go through the square's component, so only it and the other sectors need to
+  // be searched from.
+  vector<int> start;
+  if (labels.size() > 1 || nodeSector[node] != sector)
+    start.push_back(node);
+  for (int w : outside)
+    if (nodeSector[w] != sector)
+      start.push_back(w);
+  if (labels.size() != 1 || onBorder(pos, area))
+    invalidateNeighbors(chunk);
+  join(start, sector);
+}
 
 void Sectors::remove(Vec2 pos) {
   if (!contains(pos))
     return;
-  --sizes[sectors[pos]];
-  sectors[pos] = -1;
-  vector<queue<Vec2>> queues;
-  bfsTable.clear();
-  int numNeighbor = 0;
+  int chunk = getChunk(pos);
+  Rectangle area = getChunkBounds(chunk);
+  int label = local[pos];
+  int node = getNode(pos);
+  int sector = nodeSector[node];
+  vector<Vec2> inside;
+  vector<int> nodes;
   for (Vec2 v : pos.neighbors8())
     if (v.inRectangle(bounds) && contains(v)) {
-      bfsTable.setValue(v, numNeighbor++);
-      queues.emplace_back();
-      queues.back().push(v);
+      if (v.inRectangle(area))
+        inside.push_back(v);
+      else
+        nodes.push_back(getNode(v));
     }
-  if (numNeighbor == 0)
+  if (numComponents[chunk] + inside.size() > chunkArea) {
+    rebuildChunk(pos, false);
     return;
-  DisjointSets sets(numNeighbor);
-  int lastNeighbor = -1;
+  }
+  local[pos] = -1;
+  int oldNumComponents = numComponents[chunk];
+  // Neighbors that are adjacent to each other stay connected, the remaining groups might have
+  // been connected only through the square.
+  DisjointSets groups(inside.size());
+  for (int i : All(inside))
+    for (int j : Range(i))
+      if (inside[i].dist8(inside[j]) == 1)
+        groups.join(i, j);
+  for (int i : All(inside))
+    if (!groups.same(i, 0) && local[inside[i]] == label) {
+      int newLabel = numComponents[chunk]++;
+      fillChunk(inside[i], label, newLabel);
+      setSector(chunk * chunkArea + newLabel, sector);
+    }
+  bool labelLeft = false;
+  for (Vec2 v : inside) {
+    labelLeft |= (local[v] == label);
+    nodes.push_back(getNode(v));
+  }
+  if (!labelLeft)
+    setSector(node, -1);
+  if (!labelLeft || numComponents[chunk] > oldNumComponents || onBorder(pos, area))
+    invalidateNeighbors(chunk);
+  sort(nodes.begin(), nodes.end());
+  nodes.erase(unique(nodes.begin(), nodes.end()), nodes.end());
+  if (nodes.size() > 1)
+    reconnect(nodes);
+}
+
+void Sectors::fillChunk(Vec2 pos, int from, int to) {
+  Rectangle area = getChunkBounds(getChunk(pos));
+  vector<Vec2> q {pos};
+  local[pos] = to;
+  while (!q.empty()) {
+    Vec2 v = q.back();
+    q.pop_back();
+    for (Vec2 w : v.neighbors8())
+      if (w.inRectangle(area) && local[w] == from) {
+        local[w] = to;
+        q.push_back(w);
+      }
+  }
+}
+
+/** Labels the chunk from scratch, when it has run out of component labels.*/
+void Sectors::rebuildChunk(Vec2 pos, bool added) {
+  int chunk = getChunk(pos);
+  vector<int> nodes;
+  // Components that touched the chunk before the change might have been connected through it.
+  getOutsideNeighbors(chunk, nodes);
+  for (int i : Range(numComponents[chunk]))
+    if (nodeSector[chunk * chunkArea + i] > -1)
+      setSector(chunk * chunkArea + i, -1);
+  invalidateNeighbors(chunk);
+  local[pos] = added ? 0 : -1;
+  numComponents[chunk] = labelChunk(chunk);
+  invalidateNeighbors(chunk);
+  for (int i : Range(numComponents[chunk]))
+    nodes.push_back(chunk * chunkArea + i);
+  getOutsideNeighbors(chunk, nodes);
+  sort(nodes.begin(), nodes.end());
+  nodes.erase(unique(nodes.begin(), nodes.end()), nodes.end());
+  reconnect(nodes);
+}
+
+/** Moves the given components and all components connected to them to the sector.*/
+void Sectors::join(const vector<int>& nodes, int sector) {
+  queue<int> q;
+  for (int node : nodes) {
+    if (nodeSector[node] != sector)
+      setSector(node, sector);
+    q.push(node);
+  }
+  while (!q.empty()) {
+    int node = q.front();
+    q.pop();
+    for (int w : getNeighbors(node))
+      if (nodeSector[w] != sector) {
+        setSector(w, sector);
+        q.push(w);
+      }
+  }
+}
+
+// Every thread gets its own table, so that sectors of different levels can be updated concurrently.
+static DirtyTable<int>& getBfsTable(int numNodes) {
+  thread_local unique_ptr<DirtyTable<int>> table;
+  if (!table || table->getBounds().getW() < numNodes)
+    table.reset(new DirtyTable<int>(Rectangle(max(numNodes, 1), 1), -1));
+  return *table;
+}
+
+/** Fixes the sectors of the components connected to the given ones. A breadth-first search is run
+    from every one of them simultaneously, until all searches that are still running have met. The
+    finished ones have found whole connected parts, which get new sectors, and the remaining part keeps
+    its largest sector.*/
+void Sectors::reconnect(vector<int> nodes) {
+  if (nodes.empty())
+    return;
+  DirtyTable<int>& bfsTable = getBfsTable(nodeSector.size());
+  bfsTable.clear();
+  vector<queue<int>> queues(nodes.size());
+  for (int i : All(nodes)) {
+    bfsTable.setValue(Vec2(nodes[i], 0), i);
+    queues[i].push(nodes[i]);
+  }
+  DisjointSets sets(nodes.size());
+  int lastNode = -1;
   while (1) {
     vector<int> activeQueues;
-    for (auto& q : queues)
-      if (!q.empty()) {
-        Vec2 v = q.front();
-        int myNum = bfsTable.getValue(v);
-        activeQueues.push_back(myNum);
-        lastNeighbor = myNum;
-        q.pop();
-        for (Vec2 w : v.neighbors8())
-          if (w.inRectangle(bounds) && contains(w) && w != pos) {
-            if (!bfsTable.isDirty(w)) {
-              bfsTable.setValue(w, myNum);
-              q.push(w);
-            } else
-              sets.join(bfsTable.getDirtyValue(w), myNum);
-          }
+    for (int i : All(queues))
+      if (!queues[i].empty()) {
+        int node = queues[i].front();
+        queues[i].pop();
+        activeQueues.push_back(i);
+        lastNode = i;
+        for (int w : getNeighbors(node))
+          if (!bfsTable.isDirty(Vec2(w, 0))) {
+            bfsTable.setValue(Vec2(w, 0), i);
+            queues[i].push(w);
+          } else
+            sets.join(bfsTable.getDirtyValue(Vec2(w, 0)), i);
       }
-    if (sets.same(activeQueues)) {
+    if (sets.same(activeQueues))
       break;
-    }
   }
-  int maxSector = sizes.size() - 1;
-  for (Vec2 v : pos.neighbors8())
-    if (v.inRectangle(bounds) && sectors[v] <= maxSector && contains(v) &&
-        !sets.same(bfsTable.getDirtyValue(v), lastNeighbor))
-      join(v, getNewSector());
+  vector<bool> done(nodes.size(), false);
+  for (int i : All(nodes))
+    if (!done[i]) {
+      vector<int> part;
+      for (int j : All(nodes))
+        if (!done[j] && sets.same(i, j)) {
+          part.push_back(nodes[j]);
+          done[j] = true;
+        }
+      int sector = -1;
+      if (sets.same(i, lastNode)) {
+        for (int node : part)
+          if (nodeSector[node] > -1 && (sector == -1 || sizes[sector] < sizes[nodeSector[node]]))
+            sector = nodeSector[node];
+      }
+      if (sector == -1)
+        sector = getNewSector();
+      join(part, sector);
+    }
 }
 
 using namespace std;
@@ -149,7 +388,7 @@ using namespace std;
 void Sectors::dump() {
   for (int i : Range(bounds.getH())) {
     for (int j : Range(bounds.getW()))
-      cout << sectors[j][i] << " ";
+      cout << (contains(Vec2(j, i) + bounds.getTopLeft()) ? nodeSector[getNode(Vec2(j, i) + bounds.getTopLeft())] : -1) << " ";
     cout << endl;
   }
   cout << endl;
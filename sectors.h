@@ -18,6 +18,12 @@
 
 #include "util.h"
 
+/**
+  * Connectivity of a set of squares, under 8-way movement. Squares are labeled locally within square
+  * chunks, and only the components of chunks, connected across chunk borders, are labeled globally.
+  * A change relabels a single chunk and then walks the much smaller graph of components, so its
+  * cost doesn't depend on the number of squares in the affected region.
+  */
 class Sectors {
   public:
   Sectors(Rectangle bounds);
@@ -31,13 +37,37 @@ class Sectors {
 
   SERIALIZATION_DECL(Sectors);
 
+  static const int chunkSize = 16;
+
   private:
-  void setSector(Vec2, int);
+  static const int chunkArea = chunkSize * chunkSize;
+  int getChunk(Vec2) const;
+  Rectangle getChunkBounds(int chunk) const;
+  int getNode(Vec2) const;
+  int labelChunk(int chunk);
+  const vector<int>& getNeighbors(int node);
+  void invalidateNeighbors(int chunk);
+  void getOutsideNeighbors(int chunk, vector<int>& ret) const;
+  void fillChunk(Vec2, int from, int to);
+  void rebuildChunk(Vec2, bool added);
+  void reconnect(vector<int> nodes);
+  void setSector(int node, int sector);
   int getNewSector();
-  void join(Vec2, int);
+  void join(const vector<int>& nodes, int sector);
   Rectangle SERIAL(bounds);
-  Table<int> SERIAL(sectors);
+  int SERIAL(numChunksX);
+  /** Component of each square within its chunk, or -1 if the square is not in the set.*/
+  Table<int> SERIAL(local);
+  /** Number of components in each chunk.*/
+  vector<int> SERIAL(numComponents);
+  /** Sector of each component, indexed by chunk * chunkArea + local component.*/
+  vector<int> SERIAL(nodeSector);
+  /** Number of components in each sector.*/
   vector<int> SERIAL(sizes);
+  /** Components adjacent to each component, computed when needed.*/
+  unordered_map<int, vector<int>> neighbors;
 };
 
+BOOST_CLASS_VERSION(Sectors, 1)
+
 #endif
@@ -19,6 +19,10 @@
 #include "level.h"
 #include "creature.h"
 #include "square.h"
+#include "profiler.h"
+#include "bucket_queue.h"
+#include "path_clusters.h"
+#include "incremental_path.h"
 
 template <class Archive> 
 void ShortestPath::serialize(Archive& ar, const unsigned int version) {
@@ -59,21 +63,52 @@ class DistanceTable {
   int counter = 1;
 };
 
-static DistanceTable distanceTable(Level::getMaxBounds());
+struct QueueElem {
+  Vec2 pos;
+  double dist;
+};
+
+struct SearchScratch {
+  SearchScratch() : distanceTable(Level::getMaxBounds()) {}
+  DistanceTable distanceTable;
+  BucketQueue<QueueElem> searchQueue;
+};
+
+// Every thread searches in its own tables, so that paths can be found concurrently.
+static SearchScratch& getScratch() {
+  thread_local unique_ptr<SearchScratch> scratch;
+  if (!scratch)
+    scratch.reset(new SearchScratch());
+  return *scratch;
+}
 
 const int margin = 15;
 
+// Paths at least this long are first found in the level's PathClusters.
+const int hierarchicalMinDist = 2 * PathClusters::clusterSize;
+
 ShortestPath::ShortestPath(const Level* level, const Creature* creature, Vec2 to, Vec2 from, double mult)
     : target(to), directions(Vec2::directions8()), bounds(level->getBounds()) {
-  auto entryFun = [=](Vec2 pos) { 
-      if (level->getSafeSquare(pos)->canEnter(creature) || creature->getPosition() == pos) 
+  const Table<uint8_t>* costs = &level->getMovementCosts(creature->getMovementType());
+  auto entryFun = [=](Vec2 pos) {
+      if (creature->getPosition() == pos)
         return 1.0;
-      if (level->getSafeSquare(pos)->canNavigate(creature->getMovementType()))
-        return 5.0;
-      return infinity;};
+      uint8_t cost = (*costs)[pos];
+      return cost == Level::blockedCost ? infinity : cost;};
   CHECK(to.inRectangle(level->getBounds()));
   CHECK(from.inRectangle(level->getBounds()));
   if (mult == 0) {
+    if (from.dist8(to) >= hierarchicalMinDist)
+      if (auto waypoints = level->getPathWaypoints(creature->getMovementType(), from, to))
+        if (initHierarchical(entryFun, *waypoints,
+              [=](Rectangle area) { return level->isUniformCost(creature, area); }))
+          return;
+    // Short paths are mostly used for chasing, so they can be repaired later.
+    if (from.dist8(to) < hierarchicalMinDist) {
+      MovementType movement = creature->getMovementType();
+      repairEntryFun = [=](Vec2 pos) { return level->getStaticEntryCost(movement, pos); };
+      currentEntryFun = entryFun;
+    }
     // Use a suboptimal, but faster pathfinding.
     init(entryFun, [](Vec2 v)->double { return 2 * v.lengthD(); }, target, from);
   } else {
@@ -81,107 +116,295 @@ ShortestPath::ShortestPath(const Level* level, const Creature* creature, Vec2 to
     bounds = bounds.intersection(Rectangle(min(to.x, from.x) - margin, min(to.y, from.y) - margin,
         max(to.x, from.x) + margin, max(to.y, from.y) + margin));
     init(entryFun, lengthFun, target, none, revShortestLimit);
-    distanceTable.setDistance(target, infinity);
+    getScratch().distanceTable.setDistance(target, infinity);
     reverse(entryFun, lengthFun, mult, from, revShortestLimit);
   }
 }
 
 ShortestPath::ShortestPath(Rectangle a, function<double(Vec2)> entryFun, function<int(Vec2)> lengthFun,
-    vector<Vec2> dir, Vec2 to, Vec2 from, double mult) : target(to), directions(dir), bounds(a) {
+    vector<Vec2> dir, Vec2 to, Vec2 from, double mult, bool uniformCost)
+    : target(to), directions(dir), bounds(a) {
   CHECK(Level::getMaxBounds().contains(a));
-  if (mult == 0)
+  if (mult == 0) {
+    // The jump point search gives up as soon as it sees a second cost.
+    if (uniformCost && directions == Vec2::directions8() && initJumpPoint(entryFun, target, from))
+      return;
     init(entryFun, lengthFun, target, from);
-  else {
+  } else {
     init(entryFun, lengthFun, target, none, revShortestLimit);
-    distanceTable.setDistance(target, infinity);
+    getScratch().distanceTable.setDistance(target, infinity);
     reverse(entryFun, lengthFun, mult, from, revShortestLimit);
   }
 }
 
-void ShortestPath::init(function<double(Vec2)> entryFun, function<double(Vec2)> lengthFun, Vec2 target,
-    optional<Vec2> from, optional<int> limit) {
+ShortestPath::ShortestPath(const ShortestPath& o)
+    : path(o.path), target(o.target), directions(o.directions), bounds(o.bounds), reversed(o.reversed),
+      numExpanded(o.numExpanded), repairEntryFun(o.repairEntryFun), currentEntryFun(o.currentEntryFun) {
+}
+
+ShortestPath::ShortestPath(ShortestPath&&) = default;
+
+ShortestPath& ShortestPath::operator = (const ShortestPath& o) {
+  if (this != &o) {
+    path = o.path;
+    target = o.target;
+    directions = o.directions;
+    bounds = o.bounds;
+    reversed = o.reversed;
+    numExpanded = o.numExpanded;
+    repairEntryFun = o.repairEntryFun;
+    currentEntryFun = o.currentEntryFun;
+    planner.reset();
+  }
+  return *this;
+}
+
+ShortestPath& ShortestPath::operator = (ShortestPath&&) = default;
+
+ShortestPath::~ShortestPath() {
+}
+
+template <class EntryFun, class LengthFun>
+void ShortestPath::init(EntryFun entryFun, LengthFun lengthFun, Vec2 target, optional<Vec2> from,
+    optional<int> limit) {
+  PROFILE_ZONE("ShortestPath::init");
+  DistanceTable& distanceTable = getScratch().distanceTable;
+  BucketQueue<QueueElem>& searchQueue = getScratch().searchQueue;
   reversed = false;
   distanceTable.clear();
-  function<bool(Vec2, Vec2)> comparator;
-  if (from)
-    comparator = [&](Vec2 pos1, Vec2 pos2) {
-      return distanceTable.getDistance(pos1) + lengthFun(*from - pos1) > 
-          distanceTable.getDistance(pos2) + lengthFun(*from - pos2); };
-  else
-    comparator = [this](Vec2 pos1, Vec2 pos2) {
-      return distanceTable.getDistance(pos1) > distanceTable.getDistance(pos2); };
-  priority_queue<Vec2, vector<Vec2>, decltype(comparator)> q(comparator) ;
+  searchQueue.clear();
+  auto getKey = [&](Vec2 pos, double dist) {
+    return getBucketKey(from ? dist + lengthFun(*from - pos) : dist); };
   distanceTable.setDistance(target, 0);
-  q.push(target);
-  int numPopped = 0;
-  while (!q.empty()) {
-    ++numPopped;
-    Vec2 pos = q.top();
-   // Debug() << "Popping " << pos << " " << distance[pos]  << " " << (from ? (*from - pos).length4() : 0);
-    if (from == pos || (limit && distanceTable.getDistance(pos) >= *limit)) {
-      Debug() << "Shortest path from " << (from ? *from : Vec2(-1, -1)) << " to " << target << " " << numPopped
-        << " visited distance " << distanceTable.getDistance(pos);
+  searchQueue.push({target, 0}, getKey(target, 0));
+  numExpanded = 0;
+  while (!searchQueue.isEmpty()) {
+    QueueElem elem = searchQueue.pop();
+    Vec2 pos = elem.pos;
+    double cdist = distanceTable.getDistance(pos);
+    if (cdist < elem.dist)
+      continue;
+    ++numExpanded;
+    if (from == pos || (limit && cdist >= *limit)) {
+      Debug() << "Shortest path from " << (from ? *from : Vec2(-1, -1)) << " to " << target << " " << numExpanded
+        << " visited distance " << cdist;
       constructPath(pos);
       return;
     }
-    q.pop();
     for (Vec2 dir : directions) {
       Vec2 next = pos + dir;
       if (next.inRectangle(bounds)) {
-        double cdist = distanceTable.getDistance(pos);
         double ndist = distanceTable.getDistance(next);
         if (cdist < ndist) {
           double dist = cdist + entryFun(next);
           CHECK(dist > cdist) << "Entry fun non positive " << dist - cdist;
           if (dist < ndist) {
             distanceTable.setDistance(next, dist);
-            q.push(next);
+            searchQueue.push({next, dist}, getKey(next, dist));
           }
         }
       }
     }
   }
-  Debug() << "Shortest path exhausted, " << numPopped << " visited";
+  Debug() << "Shortest path exhausted, " << numExpanded << " visited";
 }
 
-void ShortestPath::reverse(function<double(Vec2)> entryFun, function<double(Vec2)> lengthFun, double mult, Vec2 from,
-    int limit) {
+template <class EntryFun, class LengthFun>
+void ShortestPath::reverse(EntryFun entryFun, LengthFun lengthFun, double mult, Vec2 from, int limit) {
+  DistanceTable& distanceTable = getScratch().distanceTable;
+  BucketQueue<QueueElem>& searchQueue = getScratch().searchQueue;
   reversed = true;
-  function<bool(Vec2, Vec2)> comparator = [=](Vec2 pos1, Vec2 pos2) {
-    return distanceTable.getDistance(pos1) + lengthFun(from - pos1) 
-      > distanceTable.getDistance(pos2) + lengthFun(from - pos2); };
-
-  priority_queue<Vec2, vector<Vec2>, decltype(comparator)> q(comparator) ;
+  searchQueue.clear();
+  auto getKey = [&](Vec2 pos, double dist) { return getBucketKey(dist + lengthFun(from - pos)); };
   for (Vec2 v : bounds) {
     double dist = distanceTable.getDistance(v);
     if (dist <= limit) {
       distanceTable.setDistance(v, mult * dist);
-      q.push(v);
+      searchQueue.push({v, mult * dist}, getKey(v, mult * dist));
     }
   }
-  int numPopped = 0;
-  while (!q.empty()) {
-    ++numPopped;
-    Vec2 pos = q.top();
+  while (!searchQueue.isEmpty()) {
+    QueueElem elem = searchQueue.pop();
+    Vec2 pos = elem.pos;
+    double cdist = distanceTable.getDistance(pos);
+    if (cdist < elem.dist)
+      continue;
+    ++numExpanded;
     if (from == pos) {
-      Debug() << "Rev shortest path from " << " from " << target << " " << numPopped << " visited";
+      Debug() << "Rev shortest path from " << " from " << target << " " << numExpanded << " visited";
       constructPath(pos, true);
       return;
     }
-    q.pop();
-    for (Vec2 dir : directions)
-      if ((pos + dir).inRectangle(bounds)) {
-        if (distanceTable.getDistance(pos + dir) > distanceTable.getDistance(pos) + entryFun(pos + dir) && 
-            distanceTable.getDistance(pos + dir) < 0) {
-          distanceTable.setDistance(pos + dir, distanceTable.getDistance(pos) + entryFun(pos + dir));
-          q.push(pos + dir);
+    for (Vec2 dir : directions) {
+      Vec2 next = pos + dir;
+      if (next.inRectangle(bounds)) {
+        double ndist = distanceTable.getDistance(next);
+        double dist = cdist + entryFun(next);
+        if (ndist > dist && ndist < 0) {
+          distanceTable.setDistance(next, dist);
+          searchQueue.push({next, dist}, getKey(next, dist));
+        }
+      }
+    }
+  }
+  Debug() << "Rev shortest path from " << " from " << target << " " << numExpanded << " visited";
+}
+
+template <class EntryFun>
+bool ShortestPath::initJumpPoint(EntryFun entryFun, Vec2 target, Vec2 from) {
+  PROFILE_ZONE("ShortestPath::initJumpPoint");
+  DistanceTable& distanceTable = getScratch().distanceTable;
+  BucketQueue<QueueElem>& searchQueue = getScratch().searchQueue;
+  reversed = false;
+  numExpanded = 0;
+  // Squares are either free, with the same cost as the first free square seen, or blocked.
+  optional<double> cost;
+  bool uniform = true;
+  auto isFree = [&](Vec2 v) {
+    if (!v.inRectangle(bounds))
+      return false;
+    double c = entryFun(v);
+    if (c >= infinity)
+      return false;
+    if (!cost)
+      cost = c;
+    else if (*cost != c)
+      uniform = false;
+    return true;
+  };
+  // A square reached by a straight or a diagonal move has a forced neighbor, if an obstacle next to it
+  // makes some shortest paths turn there. Diagonal moves can cut corners.
+  auto isForced = [&](Vec2 pos, Vec2 dir) {
+    if (dir.x == 0 || dir.y == 0) {
+      Vec2 side(dir.y, dir.x);
+      return (!isFree(pos + side) && isFree(pos + side + dir)) || (!isFree(pos - side) && isFree(pos - side + dir));
+    } else
+      return (!isFree(pos - Vec2(dir.x, 0)) && isFree(pos + Vec2(-dir.x, dir.y)))
+          || (!isFree(pos - Vec2(0, dir.y)) && isFree(pos + Vec2(dir.x, -dir.y)));
+  };
+  auto jumpStraight = [&](Vec2 pos, Vec2 dir) -> optional<Vec2> {
+    while (uniform) {
+      pos = pos + dir;
+      if (!isFree(pos))
+        return none;
+      if (pos == target || isForced(pos, dir))
+        return pos;
+    }
+    return none;
+  };
+  auto jump = [&](Vec2 pos, Vec2 dir) -> optional<Vec2> {
+    if (dir.x == 0 || dir.y == 0)
+      return jumpStraight(pos, dir);
+    while (uniform) {
+      pos = pos + dir;
+      if (!isFree(pos))
+        return none;
+      if (pos == target || isForced(pos, dir) || jumpStraight(pos, Vec2(dir.x, 0))
+          || jumpStraight(pos, Vec2(0, dir.y)))
+        return pos;
+    }
+    return none;
+  };
+  // Natural and forced neighbors of a square reached from the parent.
+  auto getDirections = [&](Vec2 pos, Vec2 parent) {
+    Vec2 dir = (pos - parent).shorten();
+    vector<Vec2> ret {dir};
+    if (dir.x == 0 || dir.y == 0) {
+      Vec2 side(dir.y, dir.x);
+      if (!isFree(pos + side))
+        ret.push_back(dir + side);
+      if (!isFree(pos - side))
+        ret.push_back(dir - side);
+    } else {
+      ret.push_back(Vec2(dir.x, 0));
+      ret.push_back(Vec2(0, dir.y));
+      if (!isFree(pos - Vec2(dir.x, 0)))
+        ret.push_back(Vec2(-dir.x, dir.y));
+      if (!isFree(pos - Vec2(0, dir.y)))
+        ret.push_back(Vec2(dir.x, -dir.y));
+    }
+    return ret;
+  };
+  unordered_map<Vec2, Vec2> parents;
+  distanceTable.clear();
+  searchQueue.clear();
+  distanceTable.setDistance(from, 0);
+  searchQueue.push({from, 0}, getBucketKey((target - from).length8()));
+  while (!searchQueue.isEmpty() && uniform) {
+    QueueElem elem = searchQueue.pop();
+    Vec2 pos = elem.pos;
+    if (distanceTable.getDistance(pos) < elem.dist)
+      continue;
+    ++numExpanded;
+    if (pos == target) {
+      Debug() << "Jump point path from " << from << " to " << target << " " << numExpanded << " visited";
+      path = {target};
+      while (pos != from) {
+        Vec2 parent = parents.at(pos);
+        Vec2 dir = (parent - pos).shorten();
+        while (pos != parent) {
+          pos = pos + dir;
+          path.push_back(pos);
+        }
+      }
+      return true;
+    }
+    auto parent = parents.find(pos);
+    for (Vec2 dir : parent == parents.end() ? Vec2::directions8() : getDirections(pos, parent->second))
+      if (auto next = jump(pos, dir)) {
+        // Every step costs the same, so the distance is just the number of steps.
+        double dist = elem.dist + pos.dist8(*next);
+        if (dist < distanceTable.getDistance(*next)) {
+          distanceTable.setDistance(*next, dist);
+          parents[*next] = pos;
+          searchQueue.push({*next, dist}, getBucketKey(dist + (target - *next).length8()));
         }
       }
   }
-  Debug() << "Rev shortest path from " << " from " << target << " " << numPopped << " visited";
+  if (!uniform)
+    Debug() << "Jump point search found non uniform costs";
+  return false;
+}
+
+template <class EntryFun>
+bool ShortestPath::initHierarchical(EntryFun entryFun, const vector<Vec2>& waypoints,
+    function<bool(Rectangle)> isUniform) {
+  PROFILE_ZONE("ShortestPath::initHierarchical");
+  Rectangle levelBounds = bounds;
+  Vec2 finalTarget = target;
+  int totalExpanded = 0;
+  const int segmentMargin = PathClusters::clusterSize / 2;
+  // Refine the segments starting from the target, so that the path is in the same order as after init().
+  vector<Vec2> fullPath;
+  for (int i = waypoints.size() - 1; i > 0; --i) {
+    Vec2 segmentFrom = waypoints[i - 1];
+    target = waypoints[i];
+    bounds = levelBounds.intersection(Rectangle(
+        min(target.x, segmentFrom.x) - segmentMargin, min(target.y, segmentFrom.y) - segmentMargin,
+        max(target.x, segmentFrom.x) + segmentMargin, max(target.y, segmentFrom.y) + segmentMargin));
+    path.clear();
+    if (!isUniform(bounds) || !initJumpPoint(entryFun, target, segmentFrom)) {
+      path.clear();
+      init(entryFun, [](Vec2 v)->double { return 2 * v.lengthD(); }, target, segmentFrom);
+    }
+    totalExpanded += numExpanded;
+    if (path.empty() || path.back() != segmentFrom) {
+      fullPath.clear();
+      break;
+    }
+    fullPath.insert(fullPath.end(), fullPath.empty() ? path.begin() : path.begin() + 1, path.end());
+  }
+  target = finalTarget;
+  bounds = levelBounds;
+  numExpanded = totalExpanded;
+  if (fullPath.empty())
+    return false;
+  path = fullPath;
+  return true;
 }
 
 void ShortestPath::constructPath(Vec2 pos, bool reversed) {
+  DistanceTable& distanceTable = getScratch().distanceTable;
   vector<Vec2> ret;
   while (pos != target) {
     Vec2 next;
@@ -208,10 +431,67 @@ void ShortestPath::constructPath(Vec2 pos, bool reversed) {
   path = vector<Vec2>(ret.rbegin(), ret.rend());
 }
 
+bool ShortestPath::initPlanner(Vec2 to, Vec2 pos) {
+  if (planner)
+    return true;
+  if (!repairEntryFun || pos.dist8(to) >= hierarchicalMinDist)
+    return false;
+  planner.reset(new IncrementalPath(bounds.intersection(Rectangle(
+      min(to.x, pos.x) - margin, min(to.y, pos.y) - margin,
+      max(to.x, pos.x) + margin, max(to.y, pos.y) + margin)), repairEntryFun, pos, to));
+  return true;
+}
+
+bool ShortestPath::updateTarget(Vec2 to, Vec2 pos) {
+  if (!initPlanner(to, pos) || !to.inRectangle(planner->getBounds()))
+    return false;
+  planner->setGoal(to);
+  return repair(pos);
+}
+
+bool ShortestPath::updateSquare(Vec2 square, Vec2 pos) {
+  if (!initPlanner(target, pos))
+    return false;
+  planner->setCost(square, currentEntryFun(square));
+  return repair(pos);
+}
+
+bool ShortestPath::repair(Vec2 pos) {
+  PROFILE_ZONE("ShortestPath::repair");
+  // Squares that were blocked by creatures get their usual cost back once the creatures are gone.
+  for (Vec2 v : planner->getCostSquares()) {
+    double cost = currentEntryFun(v);
+    if (cost == repairEntryFun(v))
+      planner->resetCost(v);
+    else
+      planner->setCost(v, cost);
+  }
+  int expanded = planner->getNumExpanded();
+  auto newPath = planner->getPath(pos);
+  numExpanded = planner->getNumExpanded() - expanded;
+  if (!newPath) {
+    Debug() << "Can't repair shortest path from " << pos << " to " << planner->getGoal();
+    return false;
+  }
+  path = *newPath;
+  target = planner->getGoal();
+  reversed = false;
+  return true;
+}
+
 bool ShortestPath::isReversed() const {
   return reversed;
 }
 
+int ShortestPath::getNumExpanded() const {
+  return numExpanded;
+}
+
+size_t ShortestPath::getMemoryUsage() const {
+  return sizeof(*this) + (path.capacity() + directions.capacity()) * sizeof(Vec2)
+      + (planner ? planner->getMemoryUsage() : 0);
+}
+
 bool ShortestPath::isReachable(Vec2 pos) const {
   return (path.size() >= 2 && path.back() == pos) || (path.size() >= 3 && path[path.size() - 2] == pos);
 }
@@ -228,22 +508,26 @@ Vec2 ShortestPath::getTarget() const {
 }
 
 Dijkstra::Dijkstra(Rectangle bounds, Vec2 from, int maxDist, function<double(Vec2)> entryFun,
-      vector<Vec2> directions) {
+      vector<Vec2> directions) : distance(1, 1, ShortestPath::infinity) {
+  DistanceTable& distanceTable = getScratch().distanceTable;
+  BucketQueue<QueueElem>& searchQueue = getScratch().searchQueue;
   distanceTable.clear();
-  function<bool(Vec2, Vec2)> comparator = [&] (Vec2 pos1, Vec2 pos2) {
-    return distanceTable.getDistance(pos1) > distanceTable.getDistance(pos2); };
-  priority_queue<Vec2, vector<Vec2>, decltype(comparator)> q(comparator) ;
+  searchQueue.clear();
   distanceTable.setDistance(from, 0);
-  q.push(from);
-  int numPopped = 0;
-  while (!q.empty()) {
-    ++numPopped;
-    Vec2 pos = q.top();
+  searchQueue.push({from, 0}, getBucketKey(0));
+  Vec2 minPos = from;
+  Vec2 maxPos = from;
+  while (!searchQueue.isEmpty()) {
+    if (searchQueue.getTopKey() > getBucketKey(maxDist))
+      break;
+    QueueElem elem = searchQueue.pop();
+    Vec2 pos = elem.pos;
     double cdist = distanceTable.getDistance(pos);
-    if (cdist > maxDist)
-      return;
-    q.pop();
-    reachable[pos] = cdist;
+    if (cdist < elem.dist || cdist > maxDist)
+      continue;
+    reachable.push_back({pos, cdist});
+    minPos = Vec2(min(minPos.x, pos.x), min(minPos.y, pos.y));
+    maxPos = Vec2(max(maxPos.x, pos.x), max(maxPos.y, pos.y));
     for (Vec2 dir : directions) {
       Vec2 next = pos + dir;
       if (next.inRectangle(bounds)) {
@@ -253,24 +537,38 @@ Dijkstra::Dijkstra(Rectangle bounds, Vec2 from, int maxDist, function<double(Vec
           CHECK(dist > cdist) << "Entry fun non positive " << dist - cdist;
           if (dist < ndist) {
             distanceTable.setDistance(next, dist);
-            q.push(next);
+            searchQueue.push({next, dist}, getBucketKey(dist));
           }
         }
       }
     }
   }
- 
+  if (reachable.empty())
+    return;
+  distance = Table<double>(Rectangle(minPos, maxPos + Vec2(1, 1)), ShortestPath::infinity);
+  // A square can be popped again after its distance improved, only the last time counts.
+  for (auto& elem : reachable)
+    distance[elem.first] = elem.second;
+  reachable.erase(remove_if(reachable.begin(), reachable.end(), [&](const pair<Vec2, double>& elem) {
+      return distance[elem.first] != elem.second; }), reachable.end());
+  stable_sort(reachable.begin(), reachable.end(),
+      [](const pair<Vec2, double>& a, const pair<Vec2, double>& b) { return a.second < b.second; });
 }
 
 bool Dijkstra::isReachable(Vec2 pos) const {
-  return reachable.count(pos);
+  return pos.inRectangle(distance.getBounds()) && distance[pos] < ShortestPath::infinity;
 }
 
 double Dijkstra::getDist(Vec2 v) const {
-  return reachable.at(v);
+  CHECK(isReachable(v));
+  return distance[v];
 }
 
-const map<Vec2, double>& Dijkstra::getAllReachable() const {
+const vector<pair<Vec2, double>>& Dijkstra::getAllReachable() const {
   return reachable;
 }
 
+size_t Dijkstra::getMemoryUsage() const {
+  return sizeof(*this) + distance.getWidth() * distance.getHeight() * sizeof(double)
+      + reachable.capacity() * sizeof(reachable[0]);
+}
@@ -22,10 +22,16 @@
 
 class Creature;
 class Level;
+class IncrementalPath;
+
+/** Cost of entering a square, ShortestPath::infinity if it's impassable.*/
+typedef function<double(Vec2)> EntryFun;
 
 class ShortestPath {
   public:
   ShortestPath(const Level* level, const Creature* creature, Vec2 target, Vec2 from, double mult = 0);
+  /** If \paramname{uniformCost} is set, all passable squares are expected to cost the same, and the path is
+      found with a jump point search.*/
   ShortestPath(
       Rectangle area,
       function<double(Vec2)> entryFun,
@@ -33,26 +39,62 @@ class ShortestPath {
       vector<Vec2> directions,
       Vec2 target,
       Vec2 from,
-      double mult = 0);
+      double mult = 0,
+      bool uniformCost = false);
+  /** A copy doesn't share the search tree used for repairs, it builds its own when needed.*/
+  ShortestPath(const ShortestPath&);
+  ShortestPath(ShortestPath&&);
+  ShortestPath& operator = (const ShortestPath&);
+  ShortestPath& operator = (ShortestPath&&);
+  ~ShortestPath();
   bool isReachable(Vec2 pos) const;
   Vec2 getNextMove(Vec2 pos);
   Vec2 getTarget() const;
   bool isReversed() const;
 
+  /** Repairs the path after the target moved, reusing the previous search. Returns false if the path
+      can't be repaired so that it continues from \paramname{pos}, then it's left unchanged.*/
+  bool updateTarget(Vec2 target, Vec2 pos);
+
+  /** Repairs the path after the cost of entering the square changed, for example it became blocked.
+      Returns false if the path can't be repaired so that it continues from \paramname{pos}.*/
+  bool updateSquare(Vec2 square, Vec2 pos);
+
+  /** Number of squares popped from the queue while computing the path.*/
+  int getNumExpanded() const;
+
+  /** Approximate number of bytes held by the path, not counting the search tables shared by all paths.*/
+  size_t getMemoryUsage() const;
+
   static const double infinity;
 
   SERIALIZATION_DECL(ShortestPath);
 
   private:
-  void init(function<double(Vec2)> entryFun, function<double(Vec2)> lengthFun, Vec2 target, optional<Vec2> from,
-      optional<int> limit = none);
-  void reverse(function<double(Vec2)> entryFun, function<double(Vec2)> lengthFun, double mult, Vec2 from, int limit);
+  template <class EntryFun, class LengthFun>
+  void init(EntryFun entryFun, LengthFun lengthFun, Vec2 target, optional<Vec2> from, optional<int> limit = none);
+  template <class EntryFun, class LengthFun>
+  void reverse(EntryFun entryFun, LengthFun lengthFun, double mult, Vec2 from, int limit);
+  template <class EntryFun>
+  bool initHierarchical(EntryFun entryFun, const vector<Vec2>& waypoints, function<bool(Rectangle)> isUniform);
+  template <class EntryFun>
+  bool initJumpPoint(EntryFun entryFun, Vec2 target, Vec2 from);
   void constructPath(Vec2 start, bool reversed = false);
+  bool initPlanner(Vec2 target, Vec2 pos);
+  bool repair(Vec2 pos);
   vector<Vec2> SERIAL(path);
   Vec2 SERIAL(target);
   vector<Vec2> SERIAL(directions);
   Rectangle SERIAL(bounds);
   bool SERIAL(reversed);
+  int numExpanded = 0;
+  /** Entry costs of a short path of a creature, which can be repaired, ignoring other creatures. They
+      change only when the level does, so the search tree stays valid as creatures move. Not saved.*/
+  function<double(Vec2)> repairEntryFun;
+  /** Current entry costs, used for the squares passed to updateSquare().*/
+  function<double(Vec2)> currentEntryFun;
+  /** Search tree for repairing the path, created on the first repair.*/
+  unique_ptr<IncrementalPath> planner;
 };
 
 class Dijkstra {
@@ -61,10 +103,17 @@ class Dijkstra {
       vector<Vec2> directions = Vec2::directions8());
   bool isReachable(Vec2) const;
   double getDist(Vec2) const;
-  const map<Vec2, double>& getAllReachable() const;
+
+  /** All reachable squares with their distances, sorted by distance.*/
+  const vector<pair<Vec2, double>>& getAllReachable() const;
+
+  /** Approximate number of bytes held by the results.*/
+  size_t getMemoryUsage() const;
   
   private:
-  map<Vec2, double> reachable;
+  /** Covers the bounding box of the reachable squares, the rest is ShortestPath::infinity.*/
+  Table<double> distance;
+  vector<pair<Vec2, double>> reachable;
 };
 
 #endif
@@ -183,8 +183,7 @@ void Square::setCreature(Creature* c) {
 
 void Square::setLevel(Level* l) {
   level = l;
-  if (ticking || !inventory.isEmpty())
-    level->addTickingSquare(position);
+  level->addTickingSquare(position);
   if (owner)
     level->addSquareOwner(owner);
 }
@@ -227,18 +226,22 @@ void Square::updateMovement() {
 }
 
 void Square::tick(double time) {
-  setDirty();
-  if (!inventory.isEmpty())
+  if (!inventory.isEmpty()) {
+    setDirty();
     for (Item* item : inventory.getItems()) {
       item->tick(time, level, position);
       if (item->isDiscarded())
         inventory.removeItem(item);
     }
+  }
+  if (poisonGas.getAmount() > 0)
+    setDirty();
   poisonGas.tick(level, position);
   if (creature && poisonGas.getAmount() > 0.2) {
     creature->poisonWithGas(min(1.0, poisonGas.getAmount()));
   }
   if (fire.isBurning()) {
+    setDirty();
     modViewObject().setAttribute(ViewObject::Attribute::BURNING, fire.getSize());
     Debug() << getName() << " burning " << fire.getSize();
     for (Square* s : level->getSquares(position.neighbors8(true)))
@@ -265,6 +268,25 @@ void Square::tick(double time) {
   tickSpecial(time);
 }
 
+bool Square::needsTickSpecial() const {
+  return ticking;
+}
+
+optional<double> Square::getNextTick(double time) const {
+  if (fire.isBurning() || poisonGas.getAmount() > 0 || (creature && creature->isStationary()) ||
+      needsTickSpecial())
+    return time;
+  for (Item* it : inventory.getItems())
+    if (it->needsTicking())
+      return time;
+  optional<double> ret;
+  for (const PTrigger& t : triggers)
+    if (auto next = t->getNextTick(time))
+      if (!ret || *next < *ret)
+        ret = *next;
+  return ret;
+}
+
 bool Square::itemLands(vector<Item*> item, const Attack& attack) const {
   if (creature) {
     if (!creature->dodgeAttack(attack))
@@ -338,8 +360,9 @@ void Square::setOnFire(double amount) {
   setDirty();
   bool burning = fire.isBurning();
   fire.set(amount);
+  // Items might get heated or catch fire even if the square doesn't.
+  level->addTickingSquare(position);
   if (!burning && fire.isBurning()) {
-    level->addTickingSquare(position);
     level->globalMessage(position, "The " + getName() + " catches fire.");
     modViewObject().setAttribute(ViewObject::Attribute::BURNING, fire.getSize());
     updateMovement();
@@ -193,8 +193,12 @@ class Square : public Renderable {
   virtual void onConstructNewSquare(Square* newSquare) {}
   
   /** Triggers all time-dependent processes like burning. Calls tick() for items if present.
-      For this method to be called, the square coordinates must be added with Level::addTickingSquare().*/
+      For this method to be called, the square must be woken up with Level::addTickingSquare().*/
   void tick(double time);
+
+  /** Returns the time when tick() needs to be called next, or none if the square can sleep until
+      it's woken up by Level::addTickingSquare().*/
+  optional<double> getNextTick(double time) const;
   void updateSunlightMovement(bool isSunlight);
 
   virtual bool canLock() const { return false; }
@@ -235,6 +239,8 @@ class Square : public Renderable {
   void onEnter(Creature*);
   virtual void onEnterSpecial(Creature*) {}
   virtual void tickSpecial(double time) {}
+  /** Returns true if tickSpecial() needs to be called every turn.*/
+  virtual bool needsTickSpecial() const;
   Inventory SERIAL(inventory);
   string SERIAL(name);
   void setMovementType(MovementType);
@@ -501,6 +501,10 @@ class Bed : public Furniture {
       getCreature()->heal(0.005);
   }
 
+  virtual bool needsTickSpecial() const override {
+    return getCreature() && getCreature()->isAffected(LastingEffect::SLEEP);
+  }
+
   template <class Archive> 
   void serialize(Archive& ar, const unsigned int version) {
     ar & SUBCLASS(Furniture);
@@ -34,6 +34,7 @@
 #include <queue>
 #include <random>
 #include <stack>
+#include <list>
 #include <stdexcept>
 #include <tuple>
 
@@ -99,6 +100,7 @@ using std::vector;
 using std::map;
 using std::set;
 using std::deque;
+using std::list;
 using std::string;
 
 #endif
@@ -383,13 +383,16 @@ static Vec2 chooseRandomClose(Vec2 start, const vector<Vec2>& squares) {
   return chooseRandom(close);
 }
 
+// Distance from the chosen storage square at which haulers stop following the storage's flow field.
+const int storageApproachDist = 5;
+
 class BringItem : public PickItem {
   public:
   BringItem(Callback* c, Vec2 position, vector<Item*> items, vector<Vec2> _target, int retries)
-      : PickItem(c, position, items, retries), target(chooseRandomClose(position, _target)) {}
+      : PickItem(c, position, items, retries), target(chooseRandomClose(position, _target)), targets(_target) {}
 
   BringItem(Callback* c, Vec2 position, vector<Item*> items, vector<Vec2> _target)
-      : PickItem(c, position, items), target(chooseRandomClose(position, _target)) {}
+      : PickItem(c, position, items), target(chooseRandomClose(position, _target)), targets(_target) {}
 
   virtual CreatureAction getBroughtAction(Creature* c, vector<Item*> it) {
     return c->drop(it).append([=](Creature* c) {
@@ -420,6 +423,11 @@ class BringItem : public PickItem {
         if (Creature* other = c->getLevel()->getSafeSquare(target)->getCreature())
           if (other->isAffected(LastingEffect::SLEEP))
             other->removeEffect(LastingEffect::SLEEP);
+      // All haulers to the same storage share a flow field towards the closest of its squares. The last
+      // few steps lead to the chosen square, so that the items are spread over the storage.
+      if (c->getPosition().dist8(target) > storageApproachDist)
+        if (auto action = c->moveAlongFlowField(targets))
+          return action;
       return c->moveTowards(target);
     }
   }
@@ -432,14 +440,22 @@ class BringItem : public PickItem {
   void serialize(Archive& ar, const unsigned int version) {
     ar& SUBCLASS(PickItem)
       & SVAR(target);
+    if (version >= 1)
+      ar & SVAR(targets);
+    else
+      targets = {target};
   }
   
   SERIALIZATION_CONSTRUCTOR(BringItem);
 
   protected:
   Vec2 SERIAL(target);
+  /** All squares of the storage.*/
+  vector<Vec2> SERIAL(targets);
 };
 
+BOOST_CLASS_VERSION(BringItem, 1)
+
 PTask Task::bringItem(Callback* c, Vec2 position, vector<Item*> items, vector<Vec2> target, int numRetries) {
   return PTask(new BringItem(c, position, items, target, numRetries));
 }
@@ -835,6 +851,17 @@ PTask Task::explore(Vec2 pos) {
   return PTask(new Explore(pos));
 }
 
+/** Attackers outside the dungeon head for the closest of its squares along a flow field shared by everyone
+    attacking it, and only chase the leader once they got in. The leader moves, so a field keyed by its
+    position would keep needing rebuilds.*/
+static CreatureAction moveTowardsLeader(Creature* c, Collective* collective) {
+  Vec2 leaderPos = collective->getLeader()->getPosition();
+  if (collective->containsSquare(leaderPos) && !collective->containsSquare(c->getPosition()))
+    if (auto action = collective->moveIntoTerritory(c))
+      return action;
+  return c->moveTowards(leaderPos);
+}
+
 namespace {
 
 class AttackLeader : public NonTransferable {
@@ -844,7 +871,7 @@ class AttackLeader : public NonTransferable {
   virtual MoveInfo getMove(Creature* c) override {
     if (c->getLevel() != collective->getLevel() || !collective->getLeader())
       return NoMove;
-    return c->moveTowards(collective->getLeader()->getPosition());
+    return moveTowardsLeader(c, collective);
   }
 
   template <class Archive> 
@@ -895,7 +922,7 @@ class KillFighters : public NonTransferable {
     }
     if (c->getLevel() != collective->getLevel())
       return NoMove;
-    return c->moveTowards(collective->getLeader()->getPosition());
+    return moveTowardsLeader(c, collective);
   }
 
   REGISTER_HANDLER(KillEvent, const Creature* victim, const Creature* killer) {
@@ -15,40 +15,262 @@
 
 #include "stdafx.h"
 
+#include <boost/filesystem.hpp>
+
 #include "debug.h"
 #include "util.h"
 #include "shortest_path.h"
 #include "level_maker.h"
 #include "test.h"
 #include "sectors.h"
+#include "indexed_heap.h"
+#include "profiler.h"
+#include "triple_buffer.h"
+#include "event.h"
+#include "timer_wheel.h"
+#include "path_clusters.h"
+#include "flow_field.h"
+#include "incremental_path.h"
+#include "path_batch.h"
+#include "safety_map.h"
+#include "level.h"
+#include "square.h"
+#include "field_of_view.h"
+#include "creature.h"
+#include "time_queue.h"
+#include "controller.h"
+#include "view_id.h"
+#include "model.h"
+#include "model_builder.h"
+#include "square_factory.h"
+#include "progress_meter.h"
+#include "item.h"
+#include "item_factory.h"
 
 void testStringConvertion() {
   CHECK(toString(1234) == "1234");
   CHECK(fromString<int>("1234") == 1234);
 }
 
+struct HeapTestElem {
+  double time;
+  int slot;
+};
+
+struct HeapTestSlot {
+  int& operator()(HeapTestElem* e) const {
+    return e->slot;
+  }
+};
+
+typedef IndexedHeap<HeapTestElem*, pair<double, int>, HeapTestSlot> TestHeap;
+
+void checkHeapSlots(const TestHeap& heap) {
+  for (int i : Range(heap.getSize()))
+    CHECKEQ(heap.getElems()[i]->slot, i);
+}
+
+void testIndexedHeap() {
+  HeapTestElem a {1, -1}, b {1.33, -1}, c {1.66, -1};
+  TestHeap q;
+  q.push(&a, {a.time, 0});
+  q.push(&b, {b.time, 1});
+  q.push(&c, {c.time, 2});
+  CHECK(q.getTop() == &a);
+  q.updateKey(a.slot, {2, 0});
+  CHECK(q.getTop() == &b);
+  q.updateKey(b.slot, {2, 1});
+  CHECK(q.getTop() == &c);
+  q.updateKey(c.slot, {3, 2});
+  CHECK(q.getTop() == &a);
+  q.updateKey(a.slot, {3, 0});
+  CHECK(q.getTop() == &b);
+  q.updateKey(c.slot, {0.5, 2});
+  CHECK(q.getTop() == &c);
+  CHECK(q.remove(c.slot) == &c);
+  CHECK(c.slot == -1);
+  CHECK(q.getTop() == &b);
+  CHECK(q.pop() == &b);
+  CHECK(q.pop() == &a);
+  CHECK(q.isEmpty());
+}
+
+void testIndexedHeap2() {
+  vector<HeapTestElem> elems(300);
+  TestHeap q;
+  for (int i : All(elems)) {
+    elems[i] = {Random.getDouble(0, 100), -1};
+    q.push(&elems[i], {elems[i].time, i});
+  }
+  for (int iter : Range(20000)) {
+    HeapTestElem* elem = &elems[Random.get(elems.size())];
+    int id = elem - &elems[0];
+    if (elem->slot == -1) {
+      elem->time = Random.getDouble(0, 100);
+      q.push(elem, {elem->time, id});
+    } else if (Random.roll(3))
+      q.remove(elem->slot);
+    else {
+      elem->time = Random.getDouble(0, 100);
+      q.updateKey(elem->slot, {elem->time, id});
+    }
+    if (iter % 100 == 0)
+      checkHeapSlots(q);
+    HeapTestElem* best = nullptr;
+    for (HeapTestElem& e : elems)
+      if (e.slot > -1 && (!best || make_pair(e.time, int(&e - &elems[0]))
+            < make_pair(best->time, int(best - &elems[0]))))
+        best = &e;
+    CHECK(q.isEmpty() == !best);
+    if (best)
+      CHECK(q.getTop() == best);
+  }
+  while (!q.isEmpty()) {
+    double time = q.getTopKey().first;
+    q.pop();
+    CHECK(q.isEmpty() || q.getTopKey().first >= time);
+  }
+}
+
+static PCreature makeTestCreature(double time) {
+  PCreature ret(new Creature(nullptr, CATTR(
+          c.viewId = ViewId::PLAYER;
+          c.name = "test";
+          for (AttrType attr : ENUM_ALL(AttrType))
+            c.attr[attr] = 1;
+          c.size = CreatureSize::MEDIUM;
+          c.weight = 90;
+          c.humanoid = true;),
+      ControllerFactory([](Creature* c) { return new DoNothingController(c); })));
+  ret->setTime(time);
+  return ret;
+}
+
+/** Creature that should be next in the queue, ties are broken by the order of creation.*/
+static Creature* getFirstCreature(const vector<Creature*>& creatures) {
+  return *std::min_element(creatures.begin(), creatures.end(), [](const Creature* c1, const Creature* c2) {
+      return make_pair(c1->getTime(), c1->getUniqueId()) < make_pair(c2->getTime(), c2->getUniqueId()); });
+}
+
 void testTimeQueue() {
- /* CreatureAttributes attr = CATTR(c.name = ""; c.speed = 5; c.size = CreatureSize::SMALL; c.strength = 1; c.dexterity = 3; c.humanoid = false; c.weight = 0.1;);
-  PCreature b(new Creature(ViewObject(ViewId::JACKAL, ViewLayer::CREATURE, ""), nullptr, attr));
-  PCreature a(new Creature(ViewObject(ViewId::PLAYER, ViewLayer::CREATURE, ""), nullptr, attr));
-  PCreature c(new Creature(ViewObject(ViewId::JACKAL, ViewLayer::CREATURE, ""), nullptr, attr));
-  Creature* rb = b.get(), *ra = a.get(), *rc = c.get();
-  a->setTime(1);
-  b->setTime(1.33);
-  c->setTime(1.66);
-  TimeQueue q;
-  q.addCreature(move(a));
-  q.addCreature(move(b));
-  q.addCreature(move(c));
-  CHECK(q.getNextCreature() == ra);
-  ra->setTime(2);
-  CHECK(q.getNextCreature() == rb);
-  rb->setTime(2);
-  CHECK(q.getNextCreature() == rc);
-  rc->setTime(3);
-  CHECK(q.getNextCreature() == rb);
-  rb->setTime(3);
-  CHECK(q.getNextCreature() == ra);*/
+  RandomGen random;
+  random.init(123);
+  TimeQueue queue;
+  vector<Creature*> creatures;
+  for (int i : Range(50)) {
+    // Few distinct times, so that there are many ties.
+    PCreature c = makeTestCreature(random.get(20));
+    creatures.push_back(c.get());
+    queue.addCreature(std::move(c));
+  }
+  for (int iter : Range(3000)) {
+    Creature* next = queue.getNextCreature();
+    CHECK(next == getFirstCreature(creatures));
+    CHECK(queue.getCurrentTime() == next->getTime());
+    double now = next->getTime();
+    switch (random.get(4)) {
+      case 0:
+        // The creature that moved is put in place without updateTime().
+        next->setTime(now + random.get(1, 5));
+        break;
+      case 1: {
+        Creature* c = creatures[random.get(creatures.size())];
+        c->setTime(max(now, c->getTime() + random.get(-3, 10)));
+        queue.updateTime(c);
+        break;
+      }
+      case 2:
+        if (creatures.size() > 10) {
+          Creature* c = creatures[random.get(creatures.size())];
+          PCreature removed = queue.removeCreature(c);
+          CHECK(removed.get() == c);
+          removeElement(creatures, c);
+          CHECK(!contains(queue.getAllCreatures(), c));
+        }
+        break;
+      case 3: {
+        PCreature c = makeTestCreature(now + random.get(5));
+        creatures.push_back(c.get());
+        queue.addCreature(std::move(c));
+        break;
+      }
+    }
+  }
+  vector<Creature*> all = queue.getAllCreatures();
+  CHECKEQ(int(all.size()), int(creatures.size()));
+  for (Creature* c : creatures)
+    CHECK(contains(all, c));
+}
+
+/** TimeQueue as it was saved before it kept the creatures in an IndexedHeap.*/
+struct OldTimeQueue {
+  struct QElem {
+    Creature* creature;
+    double time;
+
+    template <class Archive> 
+    void serialize(Archive& ar, const unsigned int version) {
+      ar& BOOST_SERIALIZATION_NVP(creature)
+        & BOOST_SERIALIZATION_NVP(time);
+    }
+  };
+
+  vector<PCreature> SERIAL(creatures);
+  priority_queue<QElem, vector<QElem>, function<bool(QElem, QElem)>> SERIAL(queue) {
+      [](QElem e1, QElem e2) { return e1.time > e2.time; }};
+  unordered_set<Creature*> SERIAL(dead);
+
+  template <class Archive> 
+  void serialize(Archive& ar, const unsigned int version) {
+    ar& SVAR(creatures)
+      & SVAR(queue)
+      & SVAR(dead);
+  }
+};
+
+void testTimeQueueLoad() {
+  for (int version : Range(2)) {
+    RandomGen random;
+    random.init(124);
+    vector<pair<double, UniqueEntity<Creature>::Id>> expected;
+    stringstream ss;
+    {
+      vector<PCreature> creatures;
+      for (int i : Range(30)) {
+        creatures.push_back(makeTestCreature(random.get(10)));
+        expected.push_back({creatures.back()->getTime(), creatures.back()->getUniqueId()});
+      }
+      OutputArchive output(ss);
+      Serialization::registerTypes(output, 0);
+      if (version == 0) {
+        OldTimeQueue queue;
+        for (PCreature& c : creatures) {
+          queue.queue.push({c.get(), c->getTime()});
+          queue.creatures.push_back(std::move(c));
+        }
+        output << BOOST_SERIALIZATION_NVP(queue);
+      } else {
+        TimeQueue queue;
+        for (PCreature& c : creatures)
+          queue.addCreature(std::move(c));
+        output << BOOST_SERIALIZATION_NVP(queue);
+      }
+    }
+    TimeQueue queue;
+    {
+      InputArchive input(ss);
+      Serialization::registerTypes(input, 0);
+      input >> BOOST_SERIALIZATION_NVP(queue);
+    }
+    sort(expected.begin(), expected.end());
+    for (auto& elem : expected) {
+      Creature* c = queue.getNextCreature();
+      CHECK(c->getTime() == elem.first);
+      CHECK(c->getUniqueId() == elem.second);
+      queue.removeCreature(c);
+    }
+    CHECK(queue.getAllCreatures().empty());
+  }
 }
 
 void testRectangleIterator() {
@@ -427,6 +649,126 @@ void testSectors3() {
   std::cout << s.getNumSectors() << " sectors" << endl;
 }
 
+static Table<int> getComponents(const Table<bool>& t, int& numComponents) {
+  Table<int> ret(t.getBounds(), -1);
+  numComponents = 0;
+  for (Vec2 pos : t.getBounds())
+    if (t[pos] && ret[pos] == -1) {
+      vector<Vec2> q {pos};
+      ret[pos] = numComponents;
+      while (!q.empty()) {
+        Vec2 v = q.back();
+        q.pop_back();
+        for (Vec2 w : v.neighbors8())
+          if (w.inRectangle(t.getBounds()) && t[w] && ret[w] == -1) {
+            ret[w] = numComponents;
+            q.push_back(w);
+          }
+      }
+      ++numComponents;
+    }
+  return ret;
+}
+
+void testSectors4() {
+  RandomGen random;
+  random.init(1234);
+  // Bounds that don't start at zero and aren't a multiple of the chunk size.
+  Rectangle bounds(-7, 3, 60, 50);
+  Sectors s(bounds);
+  Table<bool> t(bounds, false);
+  for (int i : Range(3000)) {
+    // Walls are mostly dug and built along a few lines, to make long corridors that split and merge.
+    Vec2 v = random.roll(2) ? bounds.randomVec2() : Vec2(
+        random.roll(2) ? bounds.getPX() + random.get(bounds.getW()) : bounds.getPX() + 16 * random.get(4),
+        random.roll(2) ? bounds.getPY() + random.get(bounds.getH()) : bounds.getPY() + 15 + 16 * random.get(3));
+    if (!v.inRectangle(bounds))
+      continue;
+    if (random.roll(2)) {
+      s.remove(v);
+      t[v] = false;
+    } else {
+      s.add(v);
+      t[v] = true;
+    }
+    if (i % 50 == 0) {
+      int numComponents;
+      Table<int> components = getComponents(t, numComponents);
+      vector<Vec2> repr(numComponents);
+      for (Vec2 pos : bounds)
+        if (t[pos])
+          repr[components[pos]] = pos;
+      for (Vec2 pos : bounds) {
+        CHECK(t[pos] == s.contains(pos));
+        if (t[pos])
+          CHECK(s.same(pos, repr[components[pos]]));
+      }
+      for (int j : All(repr))
+        for (int k : Range(j))
+          CHECK(!s.same(repr[j], repr[k]));
+      CHECKEQ(s.getNumSectors(), numComponents);
+    }
+  }
+}
+
+/** Sectors as saved before the squares were labeled within chunks.*/
+struct OldSectors {
+  OldSectors(Rectangle b) : bounds(b), sectors(b, -1) {}
+  Rectangle SERIAL(bounds);
+  Table<int> SERIAL(sectors);
+  vector<int> SERIAL(sizes);
+
+  template <class Archive>
+  void serialize(Archive& ar, const unsigned int version) {
+    ar& SVAR(bounds)
+      & SVAR(sectors)
+      & SVAR(sizes);
+  }
+};
+
+void testSectorsLoadOld() {
+  RandomGen random;
+  random.init(4321);
+  Rectangle bounds(-7, 3, 60, 50);
+  OldSectors old(bounds);
+  Table<bool> t(bounds, false);
+  for (Vec2 v : bounds)
+    if (random.roll(3)) {
+      // Only the membership of the squares is used on load, the old sector numbers are dropped.
+      t[v] = true;
+      old.sectors[v] = random.get(5);
+    }
+  old.sizes = vector<int>(5, 0);
+  stringstream ss;
+  {
+    OutputArchive output(ss);
+    output << old;
+  }
+  Sectors s(Rectangle(1, 1));
+  {
+    InputArchive input(ss);
+    input >> s;
+  }
+  int numComponents;
+  Table<int> components = getComponents(t, numComponents);
+  vector<Vec2> repr(numComponents);
+  for (Vec2 pos : bounds)
+    if (t[pos])
+      repr[components[pos]] = pos;
+  for (Vec2 pos : bounds) {
+    CHECK(t[pos] == s.contains(pos));
+    if (t[pos])
+      CHECK(s.same(pos, repr[components[pos]]));
+  }
+  CHECKEQ(s.getNumSectors(), numComponents);
+  // The loaded sectors can still be changed.
+  Vec2 v = repr[0];
+  s.remove(v);
+  CHECK(!s.contains(v));
+  s.add(v);
+  CHECK(s.same(v, repr[0]));
+}
+
 void testReverse() {
   vector<int> v1 {1, 2, 3, 4};
   vector<int> v2 {4, 3, 2, 1};
@@ -445,10 +787,897 @@ void testReverse3() {
   CHECKEQ(reverse2(v1), v2);
 }
 
+void testProfiler() {
+  int id1 = Profiler::getZoneId("testProfiler1");
+  int id2 = Profiler::getZoneId("testProfiler2");
+  CHECK(id1 != id2);
+  CHECKEQ(Profiler::getZoneId("testProfiler1"), id1);
+  long long start = Profiler::getMicros();
+  {
+    PROFILE_ZONE("testProfiler1");
+    PROFILE_ZONE("testProfiler2");
+  }
+  CHECK(Profiler::getMicros() >= start);
+}
+
+struct ProfilerRow {
+  int calls;
+  double total;
+  double max;
+};
+
+/** Rows of a dump with the given turn, by zone path.*/
+static map<string, ProfilerRow> readProfilerDump(const string& path, int turn) {
+  map<string, ProfilerRow> ret;
+  ifstream in(path);
+  string line;
+  while (getline(in, line)) {
+    vector<string> row = split(line, {','});
+    CHECKEQ(row.size(), 6);
+    if (row[0] == toString(turn))
+      ret[row[2]] = {fromString<int>(row[3]), fromString<double>(row[4]), fromString<double>(row[5])};
+  }
+  return ret;
+}
+
+static void waitMicros(long long micros) {
+  long long start = Profiler::getMicros();
+  while (Profiler::getMicros() < start + micros) {}
+}
+
+void testProfilerDump() {
+  string path = (boost::filesystem::temp_directory_path()
+      / boost::filesystem::unique_path("testProfilerDump-%%%%%%%%.csv")).string();
+  for (int i : Range(3)) {
+    PROFILE_ZONE("testProfilerOuter");
+    for (int j : Range(2)) {
+      PROFILE_ZONE("testProfilerInner");
+      waitMicros(1000);
+    }
+  }
+  Profiler::dump(path, 1);
+  map<string, ProfilerRow> rows = readProfilerDump(path, 1);
+  CHECK(rows.count("testProfilerOuter"));
+  CHECK(rows.count("testProfilerOuter/testProfilerInner"));
+  // The inner zone only counts under its call path.
+  CHECK(!rows.count("testProfilerInner"));
+  ProfilerRow outer = rows.at("testProfilerOuter");
+  ProfilerRow inner = rows.at("testProfilerOuter/testProfilerInner");
+  CHECKEQ(outer.calls, 3);
+  CHECKEQ(inner.calls, 6);
+  CHECK(inner.total >= 6);
+  CHECK(outer.total >= inner.total);
+  CHECK(inner.max >= 1 && inner.max <= inner.total);
+  CHECK(outer.max >= 2 && outer.max <= outer.total);
+  // Zones that weren't called since the last dump are left out.
+  Profiler::dump(path, 2);
+  rows = readProfilerDump(path, 2);
+  CHECK(!rows.count("testProfilerOuter"));
+  CHECK(!rows.count("testProfilerOuter/testProfilerInner"));
+  {
+    PROFILE_ZONE("testProfilerOuter");
+  }
+  Profiler::dump(path, 3);
+  rows = readProfilerDump(path, 3);
+  CHECKEQ(rows.at("testProfilerOuter").calls, 1);
+  CHECK(rows.at("testProfilerOuter").max < 2);
+  CHECK(!rows.count("testProfilerOuter/testProfilerInner"));
+  std::remove(path.c_str());
+}
+
+void testTripleBuffer() {
+  TripleBuffer<int> buf;
+  CHECK(!buf.update());
+  buf.getBack() = 1;
+  buf.publish();
+  buf.getBack() = 2;
+  buf.publish();
+  CHECK(buf.update());
+  CHECKEQ(buf.getFront(), 2);
+  CHECK(!buf.update());
+  CHECKEQ(buf.getFront(), 2);
+  buf.getBack() = 3;
+  buf.publish();
+  CHECK(buf.update());
+  CHECKEQ(buf.getFront(), 3);
+  TripleBuffer<pair<int, int>> buf2;
+  const int numValues = 100000;
+  thread writer([&] {
+    for (int i : Range(1, numValues + 1)) {
+      buf2.getBack() = {i, -i};
+      buf2.publish();
+    }
+  });
+  int last = 0;
+  while (last < numValues)
+    if (buf2.update()) {
+      CHECK(buf2.getFront().first > last);
+      CHECKEQ(buf2.getFront().second, -buf2.getFront().first);
+      last = buf2.getFront().first;
+    }
+  writer.join();
+}
+
+void testEventChannel() {
+  vector<EventChannelBase*> channels;
+  EventChannel<void(const Level*, int)> channel(channels);
+  CHECKEQ(channels.size(), 1);
+  int objA, objB, objC, objD, level1Mem, level2Mem;
+  const Level* level1 = reinterpret_cast<const Level*>(&level1Mem);
+  const Level* level2 = reinterpret_cast<const Level*>(&level2Mem);
+  vector<pair<char, int>> received;
+  auto checkReceived = [&](vector<pair<char, int>> expected) {
+    CHECK(received == expected);
+    received.clear();
+  };
+  channel.subscribe(&objA, [&](const Level*, int v) { received.push_back({'a', v}); });
+  channel.subscribe(&objB, [&](const Level*, int v) { received.push_back({'b', v}); });
+  channel.subscribe(&objC, [&](const Level*, int v) { received.push_back({'c', v}); }, level1);
+  CHECKEQ(channel.getNumSubscribers(), 3);
+  channel.publish(level1, 1);
+  checkReceived({{'a', 1}, {'b', 1}, {'c', 1}});
+  channel.publish(level2, 2);
+  checkReceived({{'a', 2}, {'b', 2}});
+  channel.setScope(&objA, level2);
+  channel.publish(level1, 3);
+  checkReceived({{'b', 3}, {'c', 3}});
+  // Unsubscribing self and others, and subscribing during delivery.
+  channel.subscribe(&objB, [&](const Level*, int v) {
+      received.push_back({'b', v});
+      channel.unsubscribe(&objB);
+      channel.unsubscribe(&objC);
+      channel.subscribe(&objD, [&](const Level*, int v) { received.push_back({'d', v}); });
+  });
+  channel.publish(level1, 4);
+  checkReceived({{'b', 4}});
+  CHECKEQ(channel.getNumSubscribers(), 2);
+  channel.publish(level2, 5);
+  checkReceived({{'d', 5}, {'a', 5}});
+  channel.defer(level2, 6);
+  channel.defer(level1, 7);
+  CHECK(received.empty());
+  channel.flushDeferred();
+  checkReceived({{'d', 6}, {'a', 6}, {'d', 7}});
+  {
+    EventSubscription subscription(channel, &objB, [&](const Level*, int v) { received.push_back({'b', v}); });
+    CHECKEQ(channel.getNumSubscribers(), 3);
+  }
+  CHECKEQ(channel.getNumSubscribers(), 2);
+}
+
+void testTimerWheel() {
+  TimerWheel<int> wheel;
+  vector<pair<double, int>> pending;
+  vector<pair<double, int>> fired;
+  // Timers set for a turn that was already processed fire in the next one.
+  vector<double> dueTurn;
+  int next = 0;
+  double now = 0;
+  wheel.advance(now, [](int, double) {});
+  for (int i : Range(2000)) {
+    for (int j : Range(Random.get(4))) {
+      // Mostly short timers, but some that span the coarser levels, and a few in the past.
+      double time = now + chooseRandom<double>({Random.getDouble() * 10, Random.getDouble() * 1000,
+          Random.getDouble() * 100000, -Random.getDouble() * 5}, {10, 4, 1, 1});
+      wheel.add(next, time);
+      dueTurn.push_back(max(floor(time), floor(now) + 1));
+      pending.push_back({time, next++});
+    }
+    CHECKEQ(wheel.getSize(), pending.size());
+    now += chooseRandom<double>({0.5, 1, 40, 1000}, {10, 10, 2, 1});
+    vector<pair<double, int>> expected;
+    for (int j = pending.size() - 1; j >= 0; --j)
+      if (dueTurn[pending[j].second] <= floor(now)) {
+        expected.push_back(pending[j]);
+        removeIndex(pending, j);
+      }
+    wheel.advance(now, [&](int elem, double time) { fired.push_back({time, elem}); });
+    sort(expected.begin(), expected.end());
+    sort(fired.begin(), fired.end());
+    CHECK(fired == expected);
+    fired.clear();
+  }
+}
+
+/** Squares are walls with a chance of 1 / wallChance, and every tenth of the others costs 5.*/
+static Table<double> getRandomCosts(RandomGen& random, Vec2 size, int wallChance) {
+  Table<double> ret(size.x, size.y);
+  for (Vec2 v : ret.getBounds())
+    ret[v] = random.roll(wallChance) ? ShortestPath::infinity : random.roll(10) ? 5 : 1;
+  return ret;
+}
+
+/** Reference for the path searches: lengths of the shortest paths from the closest source, paying the
+    cost of every square that is entered. With reverse, the paths lead to the closest source instead.
+    Found by Bellman-Ford relaxation, so it shares nothing with the searches.*/
+static Table<double> getReferenceDistances(const Table<double>& costs, const vector<Vec2>& sources,
+    bool reverse = false) {
+  Table<double> dist(costs.getBounds(), ShortestPath::infinity);
+  queue<Vec2> changed;
+  for (Vec2 v : sources) {
+    dist[v] = 0;
+    changed.push(v);
+  }
+  while (!changed.empty()) {
+    Vec2 v = changed.front();
+    changed.pop();
+    for (Vec2 w : v.neighbors8())
+      if (w.inRectangle(costs.getBounds())) {
+        double d = dist[v] + (reverse ? costs[v] : costs[w]);
+        if (d < dist[w]) {
+          dist[w] = d;
+          changed.push(w);
+        }
+      }
+  }
+  return dist;
+}
+
+void testPathClusters() {
+  RandomGen random;
+  random.init(125);
+  Table<double> costs = getRandomCosts(random, Vec2(100, 90), 8);
+  const double maxCost = 5;
+  PathClusters clusters(costs.getBounds(), [&](Vec2 v) { return costs[v]; });
+  auto getPos = [&] {
+    while (1) {
+      Vec2 v(random.get(costs.getWidth()), random.get(costs.getHeight()));
+      if (costs[v] < ShortestPath::infinity)
+        return v;
+    }
+  };
+  auto getCluster = [](Vec2 v) { return Vec2(v.x / PathClusters::clusterSize, v.y / PathClusters::clusterSize); };
+  int numFound = 0;
+  for (int i : Range(100)) {
+    Vec2 from = getPos();
+    Vec2 to = getPos();
+    Dijkstra optimal(costs.getBounds(), from, 1000000, [&](Vec2 v) { return costs[v]; });
+    auto waypoints = clusters.findWaypoints(from, to);
+    if (!waypoints)
+      continue;
+    ++numFound;
+    CHECK(optimal.isReachable(to));
+    CHECK(waypoints->front() == from && waypoints->back() == to);
+    double cost = 0;
+    for (int j : Range(1, waypoints->size())) {
+      Vec2 v1 = (*waypoints)[j - 1];
+      Vec2 v2 = (*waypoints)[j];
+      CHECK(v1.dist8(v2) == 1 || getCluster(v1) == getCluster(v2));
+      cost += Dijkstra(costs.getBounds(), v1, 1000000, [&](Vec2 v) { return costs[v]; }).getDist(v2);
+    }
+    // Walking along a border stretch to its transition and back costs at most clusterSize steps,
+    // and a diagonal step whose end can cross straight costs one more.
+    int numCrossings = 0;
+    for (Vec2 v = to; v != from;) {
+      Vec2 prev = v;
+      for (Vec2 n : v.neighbors8())
+        if (n.inRectangle(costs.getBounds()) && optimal.isReachable(n)
+            && optimal.getDist(n) + costs[v] == optimal.getDist(v)) {
+          prev = n;
+          break;
+        }
+      CHECK(prev != v);
+      if (getCluster(prev) != getCluster(v))
+        ++numCrossings;
+      v = prev;
+    }
+    double maxDetour = (PathClusters::clusterSize + 1) * maxCost;
+    CHECK(cost <= optimal.getDist(to) + numCrossings * maxDetour) << cost << " " << optimal.getDist(to);
+  }
+  CHECK(numFound > 50);
+  // Wall off the middle column and check that the graph gets updated.
+  for (int y : Range(costs.getHeight())) {
+    costs[Vec2(50, y)] = ShortestPath::infinity;
+    clusters.invalidate(Vec2(50, y));
+  }
+  costs[Vec2(10, 10)] = costs[Vec2(90, 10)] = 1;
+  CHECK(!clusters.findWaypoints(Vec2(10, 10), Vec2(90, 10)));
+  for (Vec2 v : {Vec2(49, 45), Vec2(50, 45), Vec2(51, 45)}) {
+    costs[v] = 1;
+    clusters.invalidate(v);
+  }
+  Dijkstra optimal(costs.getBounds(), Vec2(10, 10), 1000000, [&](Vec2 v) { return costs[v]; });
+  auto waypoints = clusters.findWaypoints(Vec2(10, 10), Vec2(90, 10));
+  CHECK(!!waypoints == optimal.isReachable(Vec2(90, 10)));
+  if (waypoints)
+    for (int j : Range(1, waypoints->size()))
+      CHECK(Dijkstra(costs.getBounds(), (*waypoints)[j - 1], 1000000, [&](Vec2 v) { return costs[v]; })
+          .isReachable((*waypoints)[j]));
+}
+
+void testFlowField() {
+  RandomGen random;
+  random.init(126);
+  Table<double> costs = getRandomCosts(random, Vec2(60, 50), 6);
+  auto entryFun = [&](Vec2 v) { return costs[v]; };
+  vector<Vec2> targets {Vec2(5, 5), Vec2(50, 40), Vec2(30, 10)};
+  for (Vec2 v : targets)
+    costs[v] = 1;
+  FlowField field(costs.getBounds(), targets, entryFun);
+  Table<double> distances = getReferenceDistances(costs, targets, true);
+  for (int i : Range(200)) {
+    Vec2 pos(random.get(costs.getWidth()), random.get(costs.getHeight()));
+    double expected = distances[pos];
+    CHECKEQ(field.getDistance(pos), expected);
+    vector<Vec2> moves = field.getNextMoves(pos);
+    CHECK(moves.empty() == (expected == 0 || expected == ShortestPath::infinity));
+    if (!moves.empty())
+      CHECKEQ(field.getDistance(moves[0]) + costs[moves[0]], expected);
+  }
+}
+
+void testDijkstra() {
+  RandomGen random;
+  random.init(128);
+  Table<double> costs = getRandomCosts(random, Vec2(40, 30), 5);
+  Vec2 from(20, 15);
+  int maxDist = 15;
+  Dijkstra dijkstra(costs.getBounds(), from, maxDist, [&](Vec2 v) { return costs[v]; });
+  Table<double> dist = getReferenceDistances(costs, {from});
+  int numReachable = 0;
+  for (Vec2 v : costs.getBounds()) {
+    CHECK(dijkstra.isReachable(v) == (dist[v] <= maxDist));
+    if (dist[v] <= maxDist) {
+      CHECKEQ(dijkstra.getDist(v), dist[v]);
+      ++numReachable;
+    }
+  }
+  auto& reachable = dijkstra.getAllReachable();
+  CHECKEQ(reachable.size(), numReachable);
+  for (int i : All(reachable)) {
+    CHECKEQ(reachable[i].second, dist[reachable[i].first]);
+    if (i > 0)
+      CHECK(reachable[i - 1].second <= reachable[i].second);
+  }
+}
+
+void testSafetyMap() {
+  RandomGen random;
+  random.init(131);
+  Table<double> costs = getRandomCosts(random, Vec2(60, 60), 5);
+  auto entryFun = [&](Vec2 v) { return costs[v]; };
+  vector<Vec2> threats {Vec2(20, 20), Vec2(26, 30)};
+  SafetyMap map(costs.getBounds(), threats, entryFun);
+  Table<double> expected = getReferenceDistances(costs, threats);
+  // Squares within the range become safer if a safer one is easy to reach, without leaving the range.
+  vector<Vec2> inRange;
+  for (Vec2 v : costs.getBounds())
+    if (expected[v] > SafetyMap::range)
+      expected[v] = ShortestPath::infinity;
+    else {
+      expected[v] *= -1.5;
+      inRange.push_back(v);
+    }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (Vec2 v : inRange)
+      for (Vec2 w : v.neighbors8())
+        if (w.inRectangle(costs.getBounds()) && expected[w] < 0 && expected[v] + costs[w] < expected[w]) {
+          expected[w] = expected[v] + costs[w];
+          changed = true;
+        }
+  }
+  for (Vec2 v : costs.getBounds()) {
+    CHECKEQ(map.getSafety(v), expected[v] < 0 ? expected[v] : ShortestPath::infinity);
+    vector<Vec2> moves = map.getSaferMoves(v);
+    for (int i : All(moves)) {
+      CHECK(moves[i].dist8(v) == 1 && map.getSafety(moves[i]) < map.getSafety(v));
+      if (i > 0)
+        CHECK(map.getSafety(moves[i - 1]) <= map.getSafety(moves[i]));
+    }
+  }
+}
+
+static double getPathCost(const vector<Vec2>& path, function<double(Vec2)> entryFun) {
+  double ret = 0;
+  for (int i : Range(path.size() - 1)) {
+    CHECK(path[i].dist8(path[i + 1]) == 1);
+    ret += entryFun(path[i]);
+  }
+  return ret;
+}
+
+static vector<Vec2> walkPath(ShortestPath path, Vec2 pos) {
+  vector<Vec2> ret {pos};
+  while (path.isReachable(ret.back()))
+    ret.push_back(path.getNextMove(ret.back()));
+  return ret;
+}
+
+void testPathBatch() {
+  WorkerPool workers(3);
+  vector<int> calls(1000, 0);
+  for (int i : Range(5)) {
+    workers.run(calls.size(), [&](int index) { ++calls[index]; });
+    for (int j : All(calls))
+      CHECKEQ(calls[j], i + 1);
+  }
+  RandomGen random;
+  random.init(129);
+  Table<double> costs = getRandomCosts(random, Vec2(80, 60), 5);
+  auto entryFun = [&](Vec2 v) { return costs[v]; };
+  vector<pair<Vec2, Vec2>> queries;
+  PathBatch batch;
+  for (int i : Range(200)) {
+    Vec2 target(random.get(costs.getWidth()), random.get(costs.getHeight()));
+    Vec2 from(random.get(costs.getWidth()), random.get(costs.getHeight()));
+    CHECKEQ(batch.add(costs.getBounds(), entryFun, target, from), i);
+    queries.push_back({target, from});
+  }
+  batch.run();
+  for (int i : All(queries)) {
+    Vec2 target = queries[i].first;
+    Vec2 from = queries[i].second;
+    double expected = getReferenceDistances(costs, {target})[from];
+    vector<Vec2> walk = walkPath(batch.getPath(i), from);
+    CHECK((walk.back() == target) == (expected < ShortestPath::infinity));
+    if (walk.back() == target)
+      CHECKEQ(getPathCost(walk, entryFun), expected);
+  }
+  // A small batch is searched without the workers, with the same results.
+  PathBatch small;
+  for (int i : Range(2))
+    small.add(costs.getBounds(), entryFun, queries[i].first, queries[i].second);
+  small.run();
+  for (int i : Range(2))
+    CHECK(walkPath(small.getPath(i), queries[i].second) == walkPath(batch.getPath(i), queries[i].second));
+}
+
+void testJumpPoint() {
+  RandomGen random;
+  random.init(130);
+  for (int wallChance : {2, 4, 10}) {
+    Table<double> costs(70, 50);
+    for (Vec2 v : costs.getBounds())
+      costs[v] = random.roll(wallChance) ? ShortestPath::infinity : 1;
+    auto entryFun = [&](Vec2 v) { return costs[v]; };
+    for (int i : Range(100)) {
+      Vec2 from(random.get(costs.getWidth()), random.get(costs.getHeight()));
+      Vec2 target(random.get(costs.getWidth()), random.get(costs.getHeight()));
+      costs[from] = costs[target] = 1;
+      ShortestPath path(costs.getBounds(), entryFun, [](Vec2 v) { return v.length8(); }, Vec2::directions8(),
+          target, from, 0, true);
+      Dijkstra dijkstra(costs.getBounds(), from, 1000000, entryFun);
+      vector<Vec2> walk = walkPath(path, from);
+      CHECK(dijkstra.isReachable(target) == (walk.back() == target));
+      if (dijkstra.isReachable(target)) {
+        for (Vec2 v : walk)
+          CHECK(costs[v] == 1);
+        CHECKEQ(getPathCost(vector<Vec2>(walk.rbegin(), walk.rend()), entryFun), dijkstra.getDist(target));
+      }
+    }
+  }
+}
+
+void testIncrementalPath() {
+  RandomGen random;
+  random.init(127);
+  Table<double> costs = getRandomCosts(random, Vec2(50, 40), 6);
+  auto entryFun = [&](Vec2 v) { return costs[v]; };
+  Vec2 start(10, 10);
+  Vec2 goal(40, 30);
+  costs[start] = costs[goal] = 1;
+  IncrementalPath planner(costs.getBounds(), entryFun, start, goal);
+  int repairExpanded = 0;
+  int freshExpanded = 0;
+  for (int i : Range(300)) {
+    if (random.roll(2)) {
+      Vec2 next = goal + Vec2::directions8()[random.get(8)];
+      if (next.inRectangle(costs.getBounds()) && costs[next] < ShortestPath::infinity) {
+        goal = next;
+        planner.setGoal(goal);
+      }
+    } else {
+      Vec2 v(random.get(costs.getWidth()), random.get(costs.getHeight()));
+      if (v != start && v != goal) {
+        costs[v] = costs[v] < ShortestPath::infinity ? ShortestPath::infinity : 1;
+        planner.updateSquare(v);
+      }
+    }
+    int expanded = planner.getNumExpanded();
+    auto path = planner.getPath(start);
+    repairExpanded += planner.getNumExpanded() - expanded;
+    IncrementalPath fresh(costs.getBounds(), entryFun, start, goal);
+    fresh.getPath(start);
+    freshExpanded += fresh.getNumExpanded();
+    double expected = getReferenceDistances(costs, {start})[goal];
+    CHECK(!!path == (expected < ShortestPath::infinity));
+    if (path) {
+      CHECK(path->front() == goal && path->back() == start);
+      CHECKEQ(getPathCost(*path, entryFun), expected);
+      // The rest of the path is found from any square along it.
+      int index = random.get(path->size());
+      Vec2 pos = (*path)[index];
+      double prefix = getPathCost(vector<Vec2>(path->begin() + index, path->end()), entryFun);
+      auto rest = planner.getPath(pos);
+      CHECK(!!rest);
+      CHECK(rest->front() == goal && rest->back() == pos);
+      CHECKEQ(getPathCost(*rest, entryFun) + prefix, expected);
+    }
+  }
+  Debug() << "Incremental path expanded " << repairExpanded << " squares, searching from scratch " << freshExpanded;
+  CHECK(repairExpanded < freshExpanded);
+}
+
+void testTransparencyMap() {
+  RandomGen random;
+  random.init(137);
+  Rectangle bounds(3, 5, 80, 150);
+  Table<bool> transparent(bounds, false);
+  TransparencyMap map(bounds);
+  for (int i : Range(5000)) {
+    Vec2 v(bounds.getPX() + random.get(bounds.getW()), bounds.getPY() + random.get(bounds.getH()));
+    transparent[v] = random.roll(2);
+    map.setTransparent(v, transparent[v]);
+  }
+  for (int x : Range(bounds.getPX() - 1, bounds.getKX() + 1))
+    for (int y : Range(bounds.getPY() - 64, bounds.getKY() + 1)) {
+      uint64_t column = map.getColumn(x, y);
+      for (int i : Range(64)) {
+        Vec2 v(x, y + i);
+        bool expected = v.inRectangle(bounds) && transparent[v];
+        CHECKEQ(bool((column >> i) & 1), expected);
+        if (i == 0)
+          CHECKEQ(map.isTransparent(v), expected);
+      }
+    }
+}
+
+static void checkFieldOfView(FieldOfView& cached, const TransparencyMap& map, Rectangle bounds, Vec2 from) {
+  FieldOfView fresh(&map, bounds);
+  vector<Vec2> expected = fresh.getVisibleTiles(from);
+  vector<Vec2> tiles = cached.getVisibleTiles(from);
+  sort(expected.begin(), expected.end());
+  sort(tiles.begin(), tiles.end());
+  CHECK(tiles == expected) << "Field of view from " << from << " is stale";
+}
+
+void testFieldOfViewCache() {
+  RandomGen random;
+  random.init(139);
+  Rectangle bounds(90, 70);
+  TransparencyMap map(bounds);
+  for (Vec2 v : bounds)
+    map.setTransparent(v, v.inRectangle(bounds.minusMargin(1)) && !random.roll(6));
+  size_t budget = FieldOfView::getCacheBudget();
+  for (size_t cacheBudget : {budget, size_t(100000)}) {
+    FieldOfView::setCacheBudget(cacheBudget);
+    FieldOfView fov(&map, bounds);
+    for (Vec2 v : bounds.minusMargin(1))
+      fov.getVisibleTiles(v);
+    for (int i : Range(50)) {
+      Vec2 pos(1 + random.get(bounds.getW() - 2), 1 + random.get(bounds.getH() - 2));
+      map.setTransparent(pos, !map.isTransparent(pos));
+      fov.squareChanged(pos);
+      for (int j : Range(20)) {
+        Vec2 from = pos + Vec2(random.get(-FieldOfView::sightRange, FieldOfView::sightRange + 1),
+            random.get(-FieldOfView::sightRange, FieldOfView::sightRange + 1));
+        if (from.inRectangle(bounds.minusMargin(1)))
+          checkFieldOfView(fov, map, bounds, from);
+      }
+    }
+    for (Vec2 v : bounds.minusMargin(1))
+      checkFieldOfView(fov, map, bounds, v);
+  }
+  FieldOfView::setCacheBudget(budget);
+}
+
+/** Fills the level with squares of random types, surrounded by a border.*/
+class RandomSquaresMaker : public LevelMaker {
+  public:
+  RandomSquaresMaker(RandomGen& r, vector<SquareType> t) : random(r), types(t) {}
+
+  virtual void make(Level::Builder* builder, Rectangle area) override {
+    for (Vec2 v : area)
+      if (v.inRectangle(area.minusMargin(1)))
+        builder->putSquare(v, types[random.get(types.size())]);
+      else
+        builder->putSquare(v, SquareId::BORDER_GUARD);
+  }
+
+  private:
+  RandomGen& random;
+  vector<SquareType> types;
+};
+
+/** Model with a single level of random squares inside a border, for the tests that need real squares
+    and creatures.*/
+struct TestLevel {
+  TestLevel(RandomGen& random, int width, int height, vector<SquareType> types = {SquareId::FLOOR})
+      : meter(1), maker(random, types),
+        model(ModelBuilder::singleLevelModel(meter, nullptr, width, height, &maker)),
+        level(model->getLevels()[0]) {}
+
+  /** Puts a new test creature on the square.*/
+  Creature* addCreature(Vec2 pos) {
+    PCreature c = makeTestCreature(0);
+    Creature* ret = c.get();
+    level->addCreature(pos, std::move(c));
+    return ret;
+  }
+
+  ProgressMeter meter;
+  RandomSquaresMaker maker;
+  PModel model;
+  Level* level;
+};
+
+static void checkMovementCosts(const Level* level, const vector<MovementType>& movements) {
+  for (const MovementType& movement : movements) {
+    const Table<uint8_t>& costs = level->getMovementCosts(movement);
+    for (Vec2 v : level->getBounds())
+      CHECKEQ(int(costs[v]), int(level->getMovementCost(movement, v)));
+  }
+}
+
+void testMovementCosts() {
+  RandomGen random;
+  random.init(140);
+  vector<SquareType> types {SquareId::FLOOR, SquareId::FLOOR, SquareId::FLOOR, SquareId::BLACK_WALL,
+      SquareId::DOOR, SquareId::WATER};
+  TestLevel test(random, 30, 30, types);
+  Level* level = test.level;
+  vector<MovementType> movements {
+      MovementType({MovementTrait::WALK}), MovementType({MovementTrait::WALK, MovementTrait::FLY})};
+  // The grids are kept up to date once they've been asked for.
+  checkMovementCosts(level, movements);
+  auto getRandomPos = [&] {
+    return Vec2(1 + random.get(level->getWidth() - 2), 1 + random.get(level->getHeight() - 2));
+  };
+  vector<Creature*> creatures;
+  auto addCreature = [&] {
+    Vec2 pos = getRandomPos();
+    if (level->getSafeSquare(pos)->canEnter(movements[0]))
+      creatures.push_back(test.addCreature(pos));
+  };
+  for (int i : Range(200))
+    addCreature();
+  checkMovementCosts(level, movements);
+  for (int i : Range(500)) {
+    switch (random.get(3)) {
+      case 0:
+        if (!creatures.empty()) {
+          Creature* c = creatures[random.get(creatures.size())];
+          Vec2 dir = Vec2::directions8()[random.get(8)];
+          if (level->canMoveCreature(c, dir))
+            level->moveCreature(c, dir);
+        }
+        break;
+      case 1:
+        if (!creatures.empty() && random.roll(2)) {
+          Creature* c = creatures[random.get(creatures.size())];
+          removeElement(creatures, c);
+          level->killCreature(c);
+        } else
+          addCreature();
+        break;
+      case 2: {
+        Vec2 pos = getRandomPos();
+        if (!level->getSafeSquare(pos)->getCreature())
+          level->replaceSquare(pos, SquareFactory::get(types[random.get(types.size())]));
+        break;
+      }
+    }
+    checkMovementCosts(level, movements);
+  }
+}
+
+void testChasePathRepair() {
+  RandomGen random;
+  random.init(142);
+  TestLevel test(random, 30, 30);
+  Level* level = test.level;
+  Creature* chaser = test.addCreature(Vec2(5, 5));
+  Creature* target = test.addCreature(Vec2(12, 9));
+  ShortestPath path(level, chaser, target->getPosition(), chaser->getPosition());
+  // Every square the target steps onto gets more costly to enter, which mustn't stop the repairs.
+  for (int i : Range(10)) {
+    Vec2 dir(1, random.get(-1, 2));
+    CHECK(level->canMoveCreature(target, dir));
+    level->moveCreature(target, dir);
+    CHECK(level->getMovementCost(chaser->getMovementType(), target->getPosition()) > 1);
+    CHECK(path.updateTarget(target->getPosition(), chaser->getPosition()));
+    CHECK(path.getTarget() == target->getPosition());
+    CHECK(path.isReachable(chaser->getPosition()));
+  }
+  // A copy repairs its own path without moving the target of the original.
+  Vec2 goal = path.getTarget();
+  ShortestPath copy = path;
+  CHECK(copy.updateTarget(goal - Vec2(1, 0), chaser->getPosition()));
+  CHECK(path.getTarget() == goal);
+  CHECK(path.updateTarget(goal + Vec2(0, 1), chaser->getPosition()));
+  CHECK(copy.getTarget() == goal - Vec2(1, 0));
+  CHECK(copy.isReachable(chaser->getPosition()));
+}
+
+void testBlockedPathRepair() {
+  RandomGen random;
+  random.init(145);
+  TestLevel test(random, 20, 20);
+  Level* level = test.level;
+  // A wall with a gap on the straight way and another one three squares off.
+  for (int y : Range(level->getHeight()))
+    if (y != 5 && y != 8)
+      level->replaceSquare(Vec2(8, y), SquareFactory::get(SquareId::BLACK_WALL));
+  Vec2 start(6, 5);
+  Vec2 goal(10, 5);
+  Creature* chaser = test.addCreature(start);
+  Creature* blocker = test.addCreature(Vec2(8, 5));
+  auto getSteps = [&](const ShortestPath& path) {
+    ShortestPath walk = path;
+    vector<Vec2> ret;
+    for (Vec2 pos = start; pos != goal; ret.push_back(pos)) {
+      CHECK(walk.isReachable(pos));
+      pos = walk.getNextMove(pos);
+    }
+    return ret;
+  };
+  ShortestPath path(level, chaser, goal, start);
+  CHECK(path.updateSquare(Vec2(8, 5), start));
+  CHECK(!contains(getSteps(path), Vec2(8, 5)));
+  // Once the blocker is gone, the straight way is free again.
+  for (Vec2 dir : {Vec2(1, -1), Vec2(1, -1)}) {
+    CHECK(level->canMoveCreature(blocker, dir));
+    level->moveCreature(blocker, dir);
+  }
+  CHECK(path.updateTarget(goal, start));
+  vector<Vec2> steps = getSteps(path);
+  CHECK(contains(steps, Vec2(8, 5)));
+  CHECKEQ(int(steps.size()), start.dist8(goal));
+}
+
+void testSafetyMapCache() {
+  RandomGen random;
+  random.init(141);
+  TestLevel test(random, 40, 40);
+  const Level* level = test.level;
+  MovementType movement({MovementTrait::WALK});
+  // The same group of threats gets the same map during the turn, whatever the order.
+  const SafetyMap* map = level->getSafetyMap(movement, {Vec2(10, 10), Vec2(12, 11)}, 100);
+  CHECK(map);
+  CHECK(map == level->getSafetyMap(movement, {Vec2(12, 11), Vec2(10, 10), Vec2(12, 11)}, 100.5));
+  CHECK(map != level->getSafetyMap(movement, {Vec2(10, 10)}, 100.5));
+  // The turn builds at most 16 maps, after that only the cached ones are returned.
+  int numBuilt = 2;
+  for (int i : Range(1, 30))
+    if (level->getSafetyMap(movement, {Vec2(i, 20)}, 100.5))
+      ++numBuilt;
+    else
+      break;
+  CHECKEQ(numBuilt, 16);
+  CHECK(!level->getSafetyMap(movement, {Vec2(30, 30)}, 100.5));
+  CHECK(map == level->getSafetyMap(movement, {Vec2(10, 10), Vec2(12, 11)}, 100.5));
+  CHECK(level->getSafetyMap(movement, {Vec2(30, 30)}, 101));
+}
+
+static vector<string> getItemNames(Level* level, Vec2 pos) {
+  vector<string> ret;
+  for (Item* it : level->getSafeSquare(pos)->getItems())
+    ret.push_back(it->getName());
+  sort(ret.begin(), ret.end());
+  return ret;
+}
+
+void testSleepingSquares() {
+  RandomGen random;
+  random.init(141);
+  TestLevel scheduledLevel(random, 20, 20);
+  TestLevel tickedLevel(random, 20, 20);
+  // The first level ticks only the awake squares, the second one ticks every square in every turn.
+  Level* scheduled = scheduledLevel.level;
+  Level* ticked = tickedLevel.level;
+  Rectangle inside = scheduled->getBounds().minusMargin(1);
+  struct Drop {
+    int turn;
+    Vec2 pos;
+    bool corpse;
+  };
+  vector<Drop> drops;
+  for (int i : Range(60))
+    drops.push_back({random.get(1, 400), Vec2(inside.getPX() + random.get(inside.getW()),
+        inside.getPY() + random.get(inside.getH())), random.roll(2)});
+  // Light corpses rot without using the random generator.
+  auto makeItem = [](bool corpse) {
+    return corpse ? ItemFactory::corpse("corpse", "skeleton", 5) : ItemFactory::fromId(ItemId::ROCK);
+  };
+  const int numTurns = 800;
+  for (int turn : Range(1, numTurns)) {
+    for (Drop& drop : drops)
+      if (drop.turn == turn) {
+        scheduled->getSafeSquare(drop.pos)->dropItem(makeItem(drop.corpse));
+        ticked->getSafeSquare(drop.pos)->dropItem(makeItem(drop.corpse));
+      }
+    scheduled->tick(turn);
+    for (Vec2 v : ticked->getBounds())
+      ticked->getSafeSquare(v)->tick(turn);
+    for (Vec2 v : scheduled->getBounds())
+      CHECK(getItemNames(scheduled, v) == getItemNames(ticked, v)) << "Square " << v << " turn " << turn;
+  }
+  Level::TickingStats stats = scheduled->getTickingStats();
+  CHECKEQ(stats.numAwake, 0);
+  CHECKEQ(stats.numScheduled, 0);
+  // After the first turn only the squares with fresh items or rotting corpses were ticked.
+  int maxTicked = scheduled->getBounds().getW() * scheduled->getBounds().getH();
+  for (Drop& drop : drops)
+    maxTicked += drop.corpse ? 301 : 1;
+  CHECK(stats.numTicked <= maxTicked) << int(stats.numTicked) << " " << maxTicked;
+  Vec2 center = inside.middle();
+  scheduled->getSafeSquare(center)->addPoisonGas(1);
+  int turn = numTurns;
+  while (scheduled->getTickingStats().numAwake > 0 && turn < 2 * numTurns)
+    scheduled->tick(++turn);
+  CHECKEQ(scheduled->getTickingStats().numAwake, 0);
+  for (Vec2 v : scheduled->getBounds())
+    CHECKEQ(scheduled->getSafeSquare(v)->getPoisonGasAmount(), 0);
+}
+
+void testSpecialItemTicks() {
+  RandomGen random;
+  random.init(144);
+  TestLevel test(random, 20, 20);
+  Level* level = test.level;
+  Vec2 amuletPos(5, 5);
+  Vec2 rockPos(10, 10);
+  level->getSafeSquare(amuletPos)->dropItem(ItemFactory::fromId(ItemId::WARNING_AMULET));
+  level->getSafeSquare(rockPos)->dropItem(ItemFactory::fromId(ItemId::ROCK));
+  for (int turn : Range(1, 20))
+    level->tick(turn);
+  // Items with a special tick keep their square awake, other items let it sleep.
+  CHECK(level->getSafeSquare(amuletPos)->getNextTick(20) == 20.0);
+  CHECK(!level->getSafeSquare(rockPos)->getNextTick(20));
+  CHECKEQ(level->getTickingStats().numAwake, 1);
+}
+
+void testCoarseSquareTicks() {
+  RandomGen random;
+  random.init(143);
+  TestLevel fullLevel(random, 20, 20);
+  TestLevel coarseLevel(random, 20, 20);
+  Level* full = fullLevel.level;
+  Level* coarse = coarseLevel.level;
+  full->tick(0);
+  coarse->tick(0);
+  coarse->setSimulationTier(Level::SimulationTier::COARSE);
+  Vec2 center = full->getBounds().middle();
+  full->getSafeSquare(center)->addPoisonGas(1);
+  coarse->getSafeSquare(center)->addPoisonGas(1);
+  // The coarse level is ticked only every few turns, but its gas spreads just as fast.
+  for (int turn : Range(1, 31)) {
+    full->tick(turn);
+    int numTicked = coarse->getTickingStats().numTicked;
+    coarse->tick(turn);
+    if (turn % Level::coarseTickInterval == 0) {
+      for (Vec2 v : full->getBounds())
+        CHECKEQ(full->getSafeSquare(v)->getPoisonGasAmount(), coarse->getSafeSquare(v)->getPoisonGasAmount());
+      if (turn == Level::coarseTickInterval)
+        CHECK(coarse->getSafeSquare(center + Vec2(2, 0))->getPoisonGasAmount() > 0);
+    } else
+      CHECKEQ(int(coarse->getTickingStats().numTicked), numTicked);
+  }
+  // A frozen level catches up on the turns it skipped when it thaws.
+  coarse->setSimulationTier(Level::SimulationTier::FROZEN);
+  full->getSafeSquare(center)->addPoisonGas(1);
+  coarse->getSafeSquare(center)->addPoisonGas(1);
+  for (int turn : Range(31, 41)) {
+    full->tick(turn);
+    coarse->tick(turn);
+  }
+  coarse->setSimulationTier(Level::SimulationTier::FULL);
+  full->tick(41);
+  coarse->catchUp(41);
+  coarse->tick(41);
+  for (Vec2 v : full->getBounds())
+    CHECKEQ(full->getSafeSquare(v)->getPoisonGasAmount(), coarse->getSafeSquare(v)->getPoisonGasAmount());
+}
+
 int testAll() {
   Debug::init();
   testStringConvertion();
+  testIndexedHeap();
+  testIndexedHeap2();
   testTimeQueue();
+  testTimeQueueLoad();
   testRectangleIterator();
   testValueCheck();
   testSplit();
@@ -476,9 +1705,469 @@ int testAll() {
   testSectors1();
   testSectors2();
   testSectors3();
+  testSectors4();
+  testSectorsLoadOld();
   testReverse();
   testReverse2();
   testReverse3();
+  testProfiler();
+  testProfilerDump();
+  testTripleBuffer();
+  testEventChannel();
+  testTimerWheel();
+  testPathClusters();
+  testFlowField();
+  testIncrementalPath();
+  testDijkstra();
+  testPathBatch();
+  testJumpPoint();
+  testSafetyMap();
+  testTransparencyMap();
+  testFieldOfViewCache();
+  testMovementCosts();
+  testChasePathRepair();
+  testBlockedPathRepair();
+  testSleepingSquares();
+  testSpecialItemTicks();
+  testSafetyMapCache();
+  testCoarseSquareTicks();
   Debug() << "-----===== OK =====-----";
   return 0;
 }
+
+struct BenchCreature {
+  double time;
+  double speed;
+  int id;
+  int slot;
+};
+
+struct BenchCreatureSlot {
+  int& operator()(BenchCreature* c) const {
+    return c->slot;
+  }
+};
+
+// Mimics the previous TimeQueue: lazy priority_queue with a std::function comparator, a set of
+// removed creatures and a linear scan on removal.
+class LazyTimeQueue {
+  public:
+  LazyTimeQueue() : queue([](QElem e1, QElem e2) {
+      return e1.time > e2.time || (e1.time == e2.time && e1.c->id > e2.c->id); }) {}
+
+  void add(BenchCreature* c) {
+    queue.push({c, c->time});
+    creatures.push_back(c);
+  }
+
+  void remove(BenchCreature* c) {
+    creatures.erase(std::find(creatures.begin(), creatures.end(), c));
+    dead.insert(c);
+  }
+
+  BenchCreature* getMin() {
+    removeDead();
+    QElem elem = queue.top();
+    if (elem.time == elem.c->time)
+      return elem.c;
+    queue.pop();
+    removeDead();
+    queue.push({elem.c, elem.c->time});
+    return queue.top().c;
+  }
+
+  private:
+  void removeDead() {
+    while (!queue.empty() && dead.count(queue.top().c))
+      queue.pop();
+  }
+
+  struct QElem {
+    BenchCreature* c;
+    double time;
+  };
+  vector<BenchCreature*> creatures;
+  priority_queue<QElem, vector<QElem>, function<bool(QElem, QElem)>> queue;
+  unordered_set<BenchCreature*> dead;
+};
+
+const int benchNumCreatures = 600;
+const int benchNumMoves = 2000000;
+const int benchReplaceFreq = 50;
+
+static vector<unique_ptr<BenchCreature>> getBenchCreatures() {
+  RandomGen random;
+  random.init(123);
+  vector<unique_ptr<BenchCreature>> ret;
+  for (int i : Range(benchNumCreatures))
+    ret.emplace_back(new BenchCreature {random.getDouble(0, 1), random.getDouble(50, 150), i, -1});
+  return ret;
+}
+
+static long long benchmarkIndexedHeap() {
+  vector<unique_ptr<BenchCreature>> all = getBenchCreatures();
+  vector<BenchCreature*> active;
+  long long start = Profiler::getMicros();
+  IndexedHeap<BenchCreature*, pair<double, int>, BenchCreatureSlot> queue;
+  for (auto& c : all) {
+    active.push_back(c.get());
+    queue.push(c.get(), {c->time, c->id});
+  }
+  for (int i : Range(benchNumMoves)) {
+    BenchCreature* c = queue.getTop();
+    c->time += 100 / c->speed;
+    queue.updateKey(c->slot, {c->time, c->id});
+    if (i % benchReplaceFreq == 0) {
+      int ind = (i / benchReplaceFreq) % active.size();
+      queue.remove(active[ind]->slot);
+      all.emplace_back(new BenchCreature {c->time + 1, active[ind]->speed, int(all.size()), -1});
+      active[ind] = all.back().get();
+      queue.push(active[ind], {active[ind]->time, active[ind]->id});
+    }
+  }
+  return Profiler::getMicros() - start;
+}
+
+static long long benchmarkLazyQueue() {
+  vector<unique_ptr<BenchCreature>> all = getBenchCreatures();
+  vector<BenchCreature*> active;
+  long long start = Profiler::getMicros();
+  LazyTimeQueue queue;
+  for (auto& c : all) {
+    active.push_back(c.get());
+    queue.add(c.get());
+  }
+  for (int i : Range(benchNumMoves)) {
+    BenchCreature* c = queue.getMin();
+    c->time += 100 / c->speed;
+    if (i % benchReplaceFreq == 0) {
+      int ind = (i / benchReplaceFreq) % active.size();
+      queue.remove(active[ind]);
+      all.emplace_back(new BenchCreature {c->time + 1, active[ind]->speed, int(all.size()), -1});
+      active[ind] = all.back().get();
+      queue.add(active[ind]);
+    }
+  }
+  return Profiler::getMicros() - start;
+}
+
+void benchmarkTimeQueue() {
+  long long heapTime = benchmarkIndexedHeap();
+  long long lazyTime = benchmarkLazyQueue();
+  std::cout << "TimeQueue: " << benchNumMoves << " moves, " << benchNumCreatures << " creatures. "
+      << "Indexed heap: " << heapTime / 1000 << " ms, lazy priority queue: " << lazyTime / 1000 << " ms"
+      << endl;
+}
+
+const int benchNumListeners = 1000;
+const int benchNumLevels = 10;
+const int benchNumEvents = 20000;
+
+static long long benchmarkEventMap(long long& numDelivered) {
+  // Mimics the previous GlobalEvents: an unordered_map of handlers that filter by level themselves.
+  vector<int> levelMem(benchNumLevels);
+  unordered_map<void*, function<void(const Level*, int)>> funs;
+  vector<int> objects(benchNumListeners);
+  for (int i : All(objects)) {
+    const Level* myLevel = reinterpret_cast<const Level*>(&levelMem[i % benchNumLevels]);
+    funs[&objects[i]] = [&numDelivered, myLevel](const Level* l, int) {
+      if (l == myLevel)
+        ++numDelivered;
+    };
+  }
+  long long start = Profiler::getMicros();
+  for (int i : Range(benchNumEvents))
+    for (auto& elem : funs)
+      elem.second(reinterpret_cast<const Level*>(&levelMem[i % benchNumLevels]), i);
+  return Profiler::getMicros() - start;
+}
+
+static long long benchmarkEventChannel(bool scoped, long long& numDelivered) {
+  vector<int> levelMem(benchNumLevels);
+  vector<EventChannelBase*> channels;
+  EventChannel<void(const Level*, int)> channel(channels);
+  vector<int> objects(benchNumListeners);
+  for (int i : All(objects)) {
+    const Level* myLevel = reinterpret_cast<const Level*>(&levelMem[i % benchNumLevels]);
+    channel.subscribe(&objects[i], [&numDelivered, myLevel](const Level* l, int) {
+      if (l == myLevel)
+        ++numDelivered;
+    }, scoped ? myLevel : nullptr);
+  }
+  long long start = Profiler::getMicros();
+  for (int i : Range(benchNumEvents))
+    channel.publish(reinterpret_cast<const Level*>(&levelMem[i % benchNumLevels]), i);
+  return Profiler::getMicros() - start;
+}
+
+void benchmarkEvents() {
+  long long delivered[3] = {0, 0, 0};
+  long long times[] = {
+    benchmarkEventMap(delivered[0]),
+    benchmarkEventChannel(false, delivered[1]),
+    benchmarkEventChannel(true, delivered[2])};
+  CHECK(delivered[0] == delivered[1] && delivered[1] == delivered[2]);
+  const char* names[] = {"unordered_map", "channel", "scoped channel"};
+  std::cout << "Events: " << benchNumEvents << " events, " << benchNumListeners << " listeners on "
+      << benchNumLevels << " levels." << endl;
+  for (int i : Range(3))
+    std::cout << "  " << names[i] << ": " << times[i] / 1000 << " ms, "
+        << benchNumEvents * 1000000LL / max(1LL, times[i]) << " events/s" << endl;
+}
+
+const int benchPathAreaSize = 250;
+const int benchNumPaths = 300;
+
+static Table<double> getBenchPathCosts() {
+  RandomGen random;
+  random.init(123);
+  return getRandomCosts(random, Vec2(benchPathAreaSize, benchPathAreaSize), 5);
+}
+
+static vector<pair<Vec2, Vec2>> getBenchPathQueries(const Table<double>& costs) {
+  RandomGen random;
+  random.init(124);
+  vector<pair<Vec2, Vec2>> ret;
+  Rectangle bounds = costs.getBounds();
+  while (ret.size() < benchNumPaths) {
+    Vec2 from(random.get(bounds.getW()), random.get(bounds.getH()));
+    Vec2 to(random.get(bounds.getW()), random.get(bounds.getH()));
+    if (costs[from] < ShortestPath::infinity && costs[to] < ShortestPath::infinity)
+      ret.push_back({from, to});
+  }
+  return ret;
+}
+
+// Mimics the previous ShortestPath::init: a priority_queue with a std::function comparator that
+// reads the current distances.
+static long long benchmarkPriorityQueuePath(const Table<double>& costs, const vector<pair<Vec2, Vec2>>& queries,
+    long long& numExpanded) {
+  Rectangle bounds = costs.getBounds();
+  Table<double> distance(bounds);
+  Table<int> dirty(bounds, 0);
+  int counter = 0;
+  auto getDistance = [&](Vec2 v) { return dirty[v] < counter ? ShortestPath::infinity : distance[v]; };
+  auto setDistance = [&](Vec2 v, double d) { distance[v] = d; dirty[v] = counter; };
+  function<double(Vec2)> entryFun = [&](Vec2 v) { return costs[v]; };
+  function<double(Vec2)> lengthFun = [](Vec2 v) { return v.length8(); };
+  long long start = Profiler::getMicros();
+  for (auto& query : queries) {
+    ++counter;
+    Vec2 from = query.first;
+    function<bool(Vec2, Vec2)> comparator = [&](Vec2 pos1, Vec2 pos2) {
+      return getDistance(pos1) + lengthFun(from - pos1) > getDistance(pos2) + lengthFun(from - pos2); };
+    priority_queue<Vec2, vector<Vec2>, decltype(comparator)> q(comparator);
+    setDistance(query.second, 0);
+    q.push(query.second);
+    while (!q.empty()) {
+      ++numExpanded;
+      Vec2 pos = q.top();
+      if (pos == from)
+        break;
+      q.pop();
+      for (Vec2 dir : Vec2::directions8()) {
+        Vec2 next = pos + dir;
+        if (next.inRectangle(bounds)) {
+          double cdist = getDistance(pos);
+          double ndist = getDistance(next);
+          if (cdist < ndist) {
+            double dist = cdist + entryFun(next);
+            if (dist < ndist) {
+              setDistance(next, dist);
+              q.push(next);
+            }
+          }
+        }
+      }
+    }
+  }
+  return Profiler::getMicros() - start;
+}
+
+static long long benchmarkBucketQueuePath(const Table<double>& costs, const vector<pair<Vec2, Vec2>>& queries,
+    long long& numExpanded) {
+  long long start = Profiler::getMicros();
+  for (auto& query : queries) {
+    ShortestPath path(costs.getBounds(), [&](Vec2 v) { return costs[v]; }, [](Vec2 v) { return v.length8(); },
+        Vec2::directions8(), query.second, query.first);
+    numExpanded += path.getNumExpanded();
+  }
+  return Profiler::getMicros() - start;
+}
+
+void benchmarkShortestPath() {
+  Table<double> costs = getBenchPathCosts();
+  vector<pair<Vec2, Vec2>> queries = getBenchPathQueries(costs);
+  long long expanded[2] = {0, 0};
+  long long times[] = {
+    benchmarkPriorityQueuePath(costs, queries, expanded[0]),
+    benchmarkBucketQueuePath(costs, queries, expanded[1])};
+  const char* names[] = {"priority_queue", "bucket queue"};
+  std::cout << "ShortestPath: " << benchNumPaths << " paths on a " << benchPathAreaSize << "x"
+      << benchPathAreaSize << " area." << endl;
+  for (int i : Range(2))
+    std::cout << "  " << names[i] << ": " << times[i] / 1000 << " ms, " << expanded[i] << " nodes, "
+        << expanded[i] * 1000000LL / max(1LL, times[i]) << " nodes/s" << endl;
+}
+
+const int benchDijkstraDist = 30;
+
+struct PathBenchStats {
+  vector<long long> micros;
+  long long expanded = 0;
+  long long memory = 0;
+};
+
+static void printPathBenchStats(const string& name, PathBenchStats& stats) {
+  sort(stats.micros.begin(), stats.micros.end());
+  long long total = 0;
+  for (long long t : stats.micros)
+    total += t;
+  int num = stats.micros.size();
+  if (num == 0)
+    return;
+  std::cout << "  " << name << ": p50 " << stats.micros[num / 2] << " us, p99 " << stats.micros[num * 99 / 100]
+      << " us, " << stats.expanded / num << " nodes, " << stats.memory / num << " bytes per query, "
+      << stats.expanded * 1000000LL / max(1LL, total) << " nodes/s" << endl;
+}
+
+/** Paths of a walking creature of the level, as the creatures find them, and the repairs of short paths
+    after the target made a step.*/
+static void benchmarkCreaturePaths(const Level* level, int numQueries) {
+  const Creature* creature = nullptr;
+  for (const Creature* c : level->getAllCreatures())
+    if (c->getMovementType().hasTrait(MovementTrait::WALK)) {
+      creature = c;
+      break;
+    }
+  if (!creature)
+    return;
+  const Table<uint8_t>& costs = level->getMovementCosts(creature->getMovementType());
+  auto isPassable = [&](Vec2 v) { return v.inRectangle(level->getBounds()) && costs[v] != Level::blockedCost; };
+  vector<Vec2> passable;
+  for (Vec2 v : level->getBounds())
+    if (isPassable(v))
+      passable.push_back(v);
+  if (passable.size() < 2)
+    return;
+  RandomGen random;
+  random.init(126);
+  PathBenchStats stats[3];
+  for (int i : Range(numQueries)) {
+    Vec2 from = passable[random.get(passable.size())];
+    Vec2 to = passable[random.get(passable.size())];
+    long long start = Profiler::getMicros();
+    ShortestPath path(level, creature, to, from);
+    stats[0].micros.push_back(Profiler::getMicros() - start);
+    stats[0].expanded += path.getNumExpanded();
+    stats[0].memory += path.getMemoryUsage();
+    to = from + Vec2(random.get(-8, 9), random.get(-8, 9));
+    if (!isPassable(to))
+      continue;
+    start = Profiler::getMicros();
+    ShortestPath chase(level, creature, to, from);
+    stats[1].micros.push_back(Profiler::getMicros() - start);
+    stats[1].expanded += chase.getNumExpanded();
+    stats[1].memory += chase.getMemoryUsage();
+    // The target runs a few steps and the path follows it.
+    for (int j : Range(4)) {
+      Vec2 next = to + Vec2::directions8()[random.get(8)];
+      if (!isPassable(next))
+        continue;
+      to = next;
+      start = Profiler::getMicros();
+      bool repaired = chase.updateTarget(to, from);
+      stats[2].micros.push_back(Profiler::getMicros() - start);
+      if (!repaired)
+        break;
+      stats[2].expanded += chase.getNumExpanded();
+      stats[2].memory += chase.getMemoryUsage();
+    }
+  }
+  std::cout << "  creature " << creature->getName().bare() << ":" << endl;
+  printPathBenchStats("creature path", stats[0]);
+  if (!stats[1].micros.empty())
+    printPathBenchStats("short creature path", stats[1]);
+  if (!stats[2].micros.empty())
+    printPathBenchStats("short path repair", stats[2]);
+}
+
+void benchmarkLevelPaths(const Level* level, int numQueries) {
+  const Table<uint8_t>& costs = level->getMovementCosts(MovementType({MovementTrait::WALK}));
+  auto entryFun = [&](Vec2 v) {
+    return costs[v] == Level::blockedCost ? ShortestPath::infinity : double(costs[v]); };
+  auto lengthFun = [](Vec2 v) { return v.length8(); };
+  vector<Vec2> passable;
+  for (Vec2 v : level->getBounds())
+    if (costs[v] != Level::blockedCost)
+      passable.push_back(v);
+  std::cout << level->getName() << " " << level->getWidth() << "x" << level->getHeight() << ", "
+      << passable.size() << " passable squares." << endl;
+  if (passable.size() < 2)
+    return;
+  RandomGen random;
+  random.init(126);
+  PathBenchStats stats[3];
+  for (int i : Range(numQueries)) {
+    Vec2 from = passable[random.get(passable.size())];
+    Vec2 to = passable[random.get(passable.size())];
+    long long start = Profiler::getMicros();
+    ShortestPath path(level->getBounds(), entryFun, lengthFun, Vec2::directions8(), to, from);
+    stats[0].micros.push_back(Profiler::getMicros() - start);
+    stats[0].expanded += path.getNumExpanded();
+    stats[0].memory += path.getMemoryUsage();
+    start = Profiler::getMicros();
+    ShortestPath reversed(level->getBounds(), entryFun, lengthFun, Vec2::directions8(), to, from, -1.5);
+    stats[1].micros.push_back(Profiler::getMicros() - start);
+    stats[1].expanded += reversed.getNumExpanded();
+    stats[1].memory += reversed.getMemoryUsage();
+    start = Profiler::getMicros();
+    Dijkstra dijkstra(level->getBounds(), from, benchDijkstraDist, entryFun);
+    stats[2].micros.push_back(Profiler::getMicros() - start);
+    stats[2].expanded += dijkstra.getAllReachable().size();
+    stats[2].memory += dijkstra.getMemoryUsage();
+  }
+  printPathBenchStats("path", stats[0]);
+  printPathBenchStats("reverse path", stats[1]);
+  printPathBenchStats("Dijkstra up to " + toString(benchDijkstraDist), stats[2]);
+  benchmarkCreaturePaths(level, numQueries);
+}
+
+void benchmarkLevelVisibility(const Level* level, int numQueries) {
+  vector<Vec2> origins;
+  for (Vec2 v : level->getBounds())
+    if (level->getSafeSquare(v)->canSeeThru(VisionId::NORMAL))
+      origins.push_back(v);
+  std::cout << level->getName() << " " << level->getWidth() << "x" << level->getHeight() << ", "
+      << origins.size() << " transparent squares." << endl;
+  if (origins.empty() || numQueries <= 0)
+    return;
+  // Keep a single entry in the cache, so that every query computes the visibility.
+  size_t budget = FieldOfView::getCacheBudget();
+  FieldOfView::setCacheBudget(0);
+  RandomGen random;
+  random.init(126);
+  vector<long long> micros;
+  long long total = 0;
+  long long numVisible = 0;
+  for (int i : Range(numQueries)) {
+    Vec2 from = origins[random.get(origins.size())];
+    long long start = Profiler::getMicros();
+    numVisible += level->getVisibleTiles(from, VisionId::NORMAL).size();
+    micros.push_back(Profiler::getMicros() - start);
+    total += micros.back();
+  }
+  FieldOfView::setCacheBudget(budget);
+  sort(micros.begin(), micros.end());
+  std::cout << "  field of view: p50 " << micros[numQueries / 2] << " us, p99 " << micros[numQueries * 99 / 100]
+      << " us, " << numVisible / numQueries << " visible squares, "
+      << numQueries * 1000000LL / max(1LL, total) << " computations/s" << endl;
+}
+
+int benchmarkAll() {
+  Debug::init();
+  benchmarkTimeQueue();
+  benchmarkEvents();
+  benchmarkShortestPath();
+  return 0;
+}
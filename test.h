@@ -16,6 +16,11 @@
 #ifndef _TEST_H
 #define _TEST_H
 
+class Level;
+
 int testAll();
+int benchmarkAll();
+void benchmarkLevelPaths(const Level*, int numQueries);
+void benchmarkLevelVisibility(const Level*, int numQueries);
 
 #endif
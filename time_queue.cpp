@@ -19,10 +19,22 @@
 #include "creature.h"
 
 template <class Archive> 
-void TimeQueue::serialize(Archive& ar, const unsigned int version) { 
-  ar& SVAR(creatures)
-    & SVAR(queue)
-    & SVAR(dead);
+void TimeQueue::save(Archive& ar, const unsigned int version) const { 
+  ar << boost::serialization::make_nvp("creatures", queue.getElems());
+}
+
+template <class Archive> 
+void TimeQueue::load(Archive& ar, const unsigned int version) { 
+  vector<PCreature> SERIAL(creatures);
+  ar >> SVAR(creatures);
+  if (version == 0) {
+    priority_queue<QElem, vector<QElem>, function<bool(QElem, QElem)>> SERIAL(oldQueue)(
+        [](QElem e1, QElem e2) { return e1.time > e2.time; });
+    unordered_set<Creature*> SERIAL(dead);
+    ar >> SVAR(oldQueue)
+       >> SVAR(dead);
+  }
+  queue.assign(std::move(creatures), getKey);
 }
 
 SERIALIZABLE(TimeQueue);
@@ -36,55 +48,51 @@ void TimeQueue::QElem::serialize(Archive& ar, const unsigned int version) {
 
 SERIALIZABLE(TimeQueue::QElem);
 
-TimeQueue::TimeQueue() : queue([](QElem e1, QElem e2) {
-    return e1.time > e2.time || (e1.time == e2.time && e1.creature->getUniqueId() > e2.creature->getUniqueId());
-}) {
+bool TimeQueue::Key::operator < (const Key& other) const {
+  return time < other.time || (time == other.time && id < other.id);
+}
+
+TimeQueue::Key TimeQueue::getKey(const PCreature& c) {
+  return {c->getTime(), c->getUniqueId()};
+}
+
+int& TimeQueue::CreatureSlot::operator()(const PCreature& c) const {
+  return c->timeQueueSlot;
+}
+
+TimeQueue::TimeQueue() {
 }
 
 void TimeQueue::addCreature(PCreature c) {
-  queue.push({c.get(), c->getTime()});
-  creatures.push_back(std::move(c));
+  Key key = getKey(c);
+  queue.push(std::move(c), key);
 }
   
 PCreature TimeQueue::removeCreature(Creature* cRef) {
-  int ind = -1;
-  for (int i : All(creatures))
-    if (creatures[i].get() == cRef) {
-      ind = i;
-      break;
-    }
-  CHECK(ind > -1) << "Creature not found";
-  PCreature ret = std::move(creatures[ind]);
-  creatures.erase(creatures.begin() + ind);
-  dead.insert(ret.get());
-  return ret;
+  int slot = cRef->timeQueueSlot;
+  CHECK(slot >= 0 && slot < queue.getSize() && queue.getElems()[slot].get() == cRef) << "Creature not found";
+  return queue.remove(slot);
+}
+
+void TimeQueue::updateTime(Creature* c) {
+  int slot = c->timeQueueSlot;
+  CHECK(slot >= 0 && slot < queue.getSize() && queue.getElems()[slot].get() == c) << "Creature not found";
+  queue.updateKey(slot, {c->getTime(), c->getUniqueId()});
 }
 
 vector<Creature*> TimeQueue::getAllCreatures() const {
   vector<Creature*> ret;
-  for (const PCreature& c : creatures)
+  for (const PCreature& c : queue.getElems())
     ret.push_back(c.get());
   return ret;
 }
 
-void TimeQueue::removeDead() {
-  while (!queue.empty() && dead.count(queue.top().creature))
-    queue.pop();
-}
-
 Creature* TimeQueue::getMinCreature() {
-  CHECK(creatures.size() > 0);
-  removeDead();
-  QElem elem = queue.top();
-  if (elem.time == elem.creature->getTime())
-    return elem.creature;
-  else {
-    queue.pop();
-    removeDead();
-    queue.push({elem.creature, elem.creature->getTime()});
-    CHECK(queue.top().creature->getTime() == queue.top().time);
-    return queue.top().creature;
-  }
+  CHECK(!queue.isEmpty());
+  // Usually only the creature that has just moved is out of date, and it's always on top.
+  while (queue.getTopKey().time != queue.getTop()->getTime())
+    updateTime(queue.getTop().get());
+  return queue.getTop().get();
 }
 
 Creature* TimeQueue::getNextCreature() {
@@ -93,7 +101,7 @@ Creature* TimeQueue::getNextCreature() {
 }
 
 double TimeQueue::getCurrentTime() {
-  if (creatures.size() > 0) 
+  if (!queue.isEmpty()) 
     return getMinCreature()->getTime();
   else
     return 0;
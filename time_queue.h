@@ -17,6 +17,8 @@
 #define _TIME_QUEUE_H
 
 #include "util.h"
+#include "indexed_heap.h"
+#include "unique_entity.h"
 
 class Creature;
 
@@ -27,17 +29,35 @@ class TimeQueue {
   vector<Creature*> getAllCreatures() const;
   void addCreature(PCreature c);
   PCreature removeCreature(Creature* c);
+
+  /** Moves the creature to its correct place in the queue after its time was changed.*/
+  void updateTime(Creature* c);
   double getCurrentTime();
 
   template <class Archive> 
-  void serialize(Archive& ar, const unsigned int version);
+  void save(Archive& ar, const unsigned int version) const;
+
+  template <class Archive> 
+  void load(Archive& ar, const unsigned int version);
+
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
 
   private:
-  void removeDead();
   Creature* getMinCreature();
 
-  vector<PCreature> SERIAL(creatures);
+  struct Key {
+    double time;
+    UniqueEntity<Creature>::Id id;
+    bool operator < (const Key&) const;
+  };
+  static Key getKey(const PCreature&);
+
+  struct CreatureSlot {
+    int& operator()(const PCreature&) const;
+  };
+  IndexedHeap<PCreature, Key, CreatureSlot> queue;
 
+  // Only used to read saves made with the old priority_queue based version.
   struct QElem {
     Creature* creature;
     double time;
@@ -45,8 +65,8 @@ class TimeQueue {
     template <class Archive> 
     void serialize(Archive& ar, const unsigned int version);
   };
-  priority_queue<QElem, vector<QElem>, function<bool(QElem, QElem)>> SERIAL(queue);
-  unordered_set<Creature*> SERIAL(dead);
 };
 
+BOOST_CLASS_VERSION(TimeQueue, 1)
+
 #endif
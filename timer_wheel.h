@@ -0,0 +1,106 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+
+#ifndef _TIMER_WHEEL_H
+#define _TIMER_WHEEL_H
+
+#include "util.h"
+
+/**
+  * Hierarchical timer wheel with a resolution of one turn. A timer set for the given time fires
+  * during the first advance() that reaches the turn containing it, or a later one if that turn was
+  * already processed. Adding a timer is O(1), and advancing by a turn costs O(1) plus the timers
+  * that fire, and occasionally moving a slot's timers down to a finer level.
+  */
+template <class T>
+class TimerWheel {
+  public:
+  void add(T elem, double time) {
+    long long turn = max<long long>(current, floor(time));
+    insert({std::move(elem), time, turn});
+    ++size;
+  }
+
+  /** Calls fun(elem, time) for every timer in the turns up to and including floor(now).
+      The function may add new timers, which fire no sooner than in the next call.*/
+  template <class Fun>
+  void advance(double now, Fun fun) {
+    long long target = floor(now);
+    while (current <= target) {
+      if (size == 0) {
+        current = target + 1;
+        return;
+      }
+      cascade();
+      vector<Timer> due;
+      due.swap(wheel[0][current & slotMask]);
+      ++current;
+      size -= due.size();
+      for (Timer& timer : due)
+        fun(timer.elem, timer.time);
+    }
+  }
+
+  int getSize() const {
+    return size;
+  }
+
+  private:
+  struct Timer {
+    T elem;
+    double time;
+    long long turn;
+  };
+
+  static const int slotBits = 8;
+  static const int numSlots = 1 << slotBits;
+  static const int slotMask = numSlots - 1;
+  static const int numLevels = 3;
+
+  void insert(Timer timer) {
+    long long delta = timer.turn - current;
+    for (int level = 0; level < numLevels; ++level)
+      if (delta < (1LL << (slotBits * (level + 1)))) {
+        wheel[level][(timer.turn >> (slotBits * level)) & slotMask].push_back(std::move(timer));
+        return;
+      }
+    overflow.push_back(std::move(timer));
+  }
+
+  void reinsert(vector<Timer>& timers) {
+    vector<Timer> tmp;
+    tmp.swap(timers);
+    for (Timer& timer : tmp)
+      insert(std::move(timer));
+  }
+
+  /** Moves the timers of the coarser levels that start in this turn down to the finer levels.*/
+  void cascade() {
+    if (current & slotMask)
+      return;
+    if ((current & ((1LL << (slotBits * numLevels)) - 1)) == 0)
+      reinsert(overflow);
+    for (int level = numLevels - 1; level > 0; --level)
+      if ((current & ((1LL << (slotBits * level)) - 1)) == 0)
+        reinsert(wheel[level][(current >> (slotBits * level)) & slotMask]);
+  }
+
+  vector<Timer> wheel[numLevels][numSlots];
+  vector<Timer> overflow;
+  long long current = 0;
+  int size = 0;
+};
+
+#endif
@@ -61,6 +61,7 @@ bool Trigger::interceptsFlyingItem(Item* it) const { return false; }
 void Trigger::onInterceptFlyingItem(vector<PItem> it, const Attack& a, int remainingDist, Vec2 dir, VisionId) {}
 bool Trigger::isDangerous(const Creature* c) const { return false; }
 void Trigger::tick(double time) {}
+optional<double> Trigger::getNextTick(double time) const { return none; }
 
 namespace {
 
@@ -87,6 +88,7 @@ class Portal : public Trigger {
         previous->otherPortal = Model::PortalInfo(l, position);
         l->getModel()->resetDanglingPortal();
         startTime = previous->startTime = -1;
+        portalInfo->level()->addTickingSquare(portalInfo->position());
         return;
       }
     l->getModel()->setDanglingPortal(Model::PortalInfo(l, position));
@@ -136,6 +138,13 @@ class Portal : public Trigger {
     }
   }
 
+  virtual optional<double> getNextTick(double time) const override {
+    if (startTime == -1)
+      return time;
+    else
+      return startTime + 30;
+  }
+
   template <class Archive>
   void serialize(Archive& ar, const unsigned int version) {
     ar& SUBCLASS(Trigger)
@@ -271,6 +280,10 @@ class MeteorShower : public Trigger {
           break;
   }
 
+  virtual optional<double> getNextTick(double time) const override {
+    return time;
+  }
+
   const int areaWidth = 3;
   const int range = 4;
 
@@ -37,6 +37,8 @@ class Trigger {
 
   virtual bool isDangerous(const Creature* c) const;
   virtual void tick(double time);
+  /** Returns the time when tick() needs to be called next, or none if it doesn't do anything.*/
+  virtual optional<double> getNextTick(double time) const;
   virtual void setOnFire(double size);
   virtual double getLightEmission() const;
 
@@ -0,0 +1,64 @@
+/* Copyright (C) 2013-2014 Michal Brzozowski (rusolis@poczta.fm)
+
+   This file is part of KeeperRL.
+
+   KeeperRL is free software; you can redistribute it and/or modify it under the terms of the
+   GNU General Public License as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   KeeperRL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along with this program.
+   If not, see http://www.gnu.org/licenses/ . */
+
+#ifndef _TRIPLE_BUFFER_H
+#define _TRIPLE_BUFFER_H
+
+#include "util.h"
+
+/**
+  * Lock-free single producer, single consumer channel that always hands the consumer the latest
+  * published value. The writer fills getBack() and calls publish(), the reader calls update() and
+  * reads getFront(). Neither side ever waits for the other. Values that were overwritten before
+  * the reader got to them are dropped, and slots are reused, so the writer must refill every
+  * field it publishes.
+  */
+template <class T>
+class TripleBuffer {
+  public:
+  /** Slot owned by the writer. Only to be used by the writing thread.*/
+  T& getBack() {
+    return slots[back];
+  }
+
+  /** Makes the back slot available to the reader and takes over an unused one.*/
+  void publish() {
+    back = middle.exchange(back | freshBit) & indexMask;
+  }
+
+  /** Takes over the latest published slot. Returns false if nothing new was published since the
+      last call. Only to be used by the reading thread.*/
+  bool update() {
+    if (!(middle.load() & freshBit))
+      return false;
+    front = middle.exchange(front) & indexMask;
+    return true;
+  }
+
+  /** Slot owned by the reader.*/
+  const T& getFront() const {
+    return slots[front];
+  }
+
+  private:
+  static const int freshBit = 4;
+  static const int indexMask = 3;
+  T slots[3];
+  int back = 0;
+  atomic<int> middle {1};
+  int front = 2;
+};
+
+#endif
@@ -737,6 +737,67 @@ AsyncLoop::~AsyncLoop() {
   t.join();
 }
 
+WorkerPool::WorkerPool(int numThreads) : nextJob(0) {
+  for (int i : Range(numThreads))
+    threads.emplace_back(new thread([this] { work(); }));
+}
+
+WorkerPool::~WorkerPool() {
+  std::unique_lock<std::mutex> lock(mut);
+  done = true;
+  lock.unlock();
+  startCond.notify_all();
+  for (auto& t : threads)
+    t->join();
+}
+
+int WorkerPool::getNumThreads() const {
+  return threads.size();
+}
+
+void WorkerPool::run(int num, function<void(int)> fun) {
+  if (num == 0)
+    return;
+  std::unique_lock<std::mutex> lock(mut);
+  job = fun;
+  numJobs = num;
+  nextJob = 0;
+  numBusy = threads.size();
+  ++generation;
+  lock.unlock();
+  startCond.notify_all();
+  runJobs();
+  lock.lock();
+  while (numBusy > 0)
+    doneCond.wait(lock);
+}
+
+void WorkerPool::runJobs() {
+  while (1) {
+    int index = nextJob++;
+    if (index >= numJobs)
+      break;
+    job(index);
+  }
+}
+
+void WorkerPool::work() {
+  int lastGeneration = 0;
+  while (1) {
+    std::unique_lock<std::mutex> lock(mut);
+    while (!done && generation == lastGeneration)
+      startCond.wait(lock);
+    if (done)
+      return;
+    lastGeneration = generation;
+    lock.unlock();
+    runJobs();
+    lock.lock();
+    if (--numBusy == 0)
+      doneCond.notify_one();
+  }
+}
+
 ConstructorFunction::ConstructorFunction(function<void()> fun) {
   fun();
 }
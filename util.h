@@ -1347,6 +1347,34 @@ class AsyncLoop {
   std::atomic<bool> done;
 };
 
+/** Fixed set of threads that run batches of independent jobs.*/
+class WorkerPool {
+  public:
+  WorkerPool(int numThreads);
+  ~WorkerPool();
+
+  /** Calls job(i) for every i in [0, numJobs), spread over the workers and the calling thread.
+      Returns when all calls are done.*/
+  void run(int numJobs, function<void(int)> job);
+
+  int getNumThreads() const;
+
+  private:
+  void work();
+  void runJobs();
+
+  vector<unique_ptr<thread>> threads;
+  std::mutex mut;
+  std::condition_variable startCond;
+  std::condition_variable doneCond;
+  function<void(int)> job;
+  int numJobs = 0;
+  std::atomic<int> nextJob;
+  int generation = 0;
+  int numBusy = 0;
+  bool done = false;
+};
+
 template <typename T, typename... Args>
 function<void(Args...)> bindMethod(void (T::*ptr) (Args...), T* t) {
   return [=](Args... a) { (t->*ptr)(a...);};
@@ -54,7 +54,7 @@ optional<VillageControl::Villain&> VillageControl::getVillain(const Creature* c)
 void VillageControl::onKillEvent(const Creature* victim, const Creature* killer) {
   if (victim->getTribe() == getCollective()->getTribe())
     if (auto villain = getVillain(killer)) {
-      if (contains(getCollective()->getCreatures(), victim))
+      if (getCollective()->hasCreature(victim))
         victims[villain->collective] += 1;
       else
         victims[villain->collective] += 0.15; // small increase for same tribe but different village
@@ -230,7 +230,7 @@ static double stolenItemsFun(int numStolen) {
 }
 
 bool VillageControl::Villain::contains(const Creature* c) {
-  return ::contains(collective->getCreatures(), c);
+  return collective->hasCreature(c);
 }
 
 double VillageControl::Villain::getTriggerValue(const Trigger& trigger, const VillageControl* self,
@@ -194,6 +194,7 @@ void WindowView::reset() {
   mapLayout = &currentTileLayout.normalLayout;
   gameReady = false;
   wasRendered = false;
+  ++frameGeneration;
   minimapGui->clear();
   mapGui->clearCenter();
   guiBuilder.reset();
@@ -492,30 +493,36 @@ void WindowView::drawLevelMap(const CreatureView* creature) {
         [this](double x, double y) { mapGui->setCenter(x, y);}); });
 }
 
-void WindowView::updateMinimap(const CreatureView* creature) {
-  const Level* level = creature->getLevel();
-  Vec2 rad(40, 40);
-  Vec2 playerPos = mapGui->getScreenPos().div(mapLayout->getSquareSize());
-  Rectangle bounds(playerPos - rad, playerPos + rad);
-  minimapGui->update(level, bounds, creature);
-}
-
 void WindowView::updateView(const CreatureView* collective, bool noRefresh) {
   if (!wasRendered)
     return;
-  RenderLock lock(renderMutex);
   wasRendered = false;
+  FrameSnapshot& frame = frames.getBack();
+  frame.generation = frameGeneration;
+  frame.noRefresh = noRefresh;
+  collective->refreshGameInfo(frame.gameInfo);
+  mapAreas.update();
+  MapGui::captureSnapshot(collective, mapAreas.getFront(), frame.map);
+  Vec2 rad(40, 40);
+  minimapGui->captureSnapshot(collective->getLevel(), Rectangle(frame.map.center - rad, frame.map.center + rad),
+      collective, frame.minimap);
+  frames.publish();
+}
+
+void WindowView::applyFrame(const FrameSnapshot& frame) {
+  if (frame.generation != frameGeneration)
+    return;
   guiBuilder.addUpsCounterTick();
   gameReady = true;
-  if (!noRefresh)
+  if (!frame.noRefresh)
     uiLock = false;
   switchTiles();
-  collective->refreshGameInfo(gameInfo);
+  gameInfo = frame.gameInfo;
   mapGui->setSpriteMode(currentTileLayout.sprites);
   bool spectator = gameInfo.infoType == GameInfo::InfoType::SPECTATOR;
-  mapGui->updateObjects(collective, mapLayout, currentTileLayout.sprites || spectator,
+  mapGui->updateObjects(frame.map, mapLayout, currentTileLayout.sprites || spectator,
       !spectator, guiBuilder.showMorale());
-  updateMinimap(collective);
+  minimapGui->update(frame.minimap);
   if (gameInfo.infoType == GameInfo::InfoType::SPECTATOR)
     guiBuilder.setGameSpeed(GuiBuilder::GameSpeed::NORMAL);
 }
@@ -540,12 +547,17 @@ void WindowView::animation(Vec2 pos, AnimationId id) {
 void WindowView::refreshView() {
   {
     RenderLock lock(renderMutex);
+    if (frames.update())
+      applyFrame(frames.getFront());
     if (!wasRendered)
       rebuildGui();
     wasRendered = true;
     CHECK(currentThreadId() == renderThreadId);
-    if (gameReady)
+    if (gameReady) {
       processEvents();
+      mapAreas.getBack() = mapGui->getVisibleTiles();
+      mapAreas.publish();
+    }
     if (renderDialog)
       renderDialog();
     if (uiLock && !renderDialog)
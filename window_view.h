@@ -24,6 +24,7 @@
 #include "input_queue.h"
 #include "animation.h"
 #include "gui_builder.h"
+#include "triple_buffer.h"
 
 class ViewIndex;
 class Options;
@@ -91,7 +92,14 @@ class WindowView: public View {
   void processEvents();
   void displayMenuSplash2();
   void displayOldSplash();
-  void updateMinimap(const CreatureView*);
+  struct FrameSnapshot {
+    GameInfo gameInfo;
+    MapGui::Snapshot map;
+    MinimapGui::Snapshot minimap;
+    bool noRefresh;
+    int generation;
+  };
+  void applyFrame(const FrameSnapshot&);
   void mapLeftClickFun(Vec2);
   void mapCreatureClickFun(UniqueEntity<Creature>::Id);
   void mapRightClickFun(Vec2);
@@ -144,6 +152,10 @@ class WindowView: public View {
   bool uiLock = false;
   atomic<bool> refreshInput;
   atomic<bool> wasRendered;
+  /** Frames go from the game thread to the render thread, and the visible map area goes back.*/
+  TripleBuffer<FrameSnapshot> frames;
+  TripleBuffer<optional<Rectangle>> mapAreas;
+  atomic<int> frameGeneration {0};
 
   typedef std::unique_lock<std::recursive_mutex> RenderLock;
 